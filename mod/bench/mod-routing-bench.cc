@@ -0,0 +1,478 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+// Benchmarks for the mod module: route table build, lookups and tag
+// serialization over random-geometric, grid and fat-tree topologies.
+// Results are written as JSON, one record per (topology, size).
+//
+//   ./waf --run "mod-routing-bench --sizes=100,500,1000 --out=bench.json"
+
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/mod-routing-table.h"
+#include "ns3/mod-failover-tag.h"
+#include "ns3/mod-source-route-tag.h"
+#include "ns3/MyTag.h"
+
+using namespace ns3;
+
+namespace {
+
+double
+WallSeconds (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+long
+PeakRssKb (void)
+{
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+// Hardware counter, read with perf_event_open where the kernel allows it.
+class PerfCounter
+{
+public:
+  PerfCounter (uint32_t type, uint64_t config)
+    : m_fd (-1)
+  {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset (&attr, 0, sizeof (attr));
+    attr.size = sizeof (attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    m_fd = syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+  ~PerfCounter ()
+  {
+#ifdef __linux__
+    if (m_fd >= 0)
+      {
+        close (m_fd);
+      }
+#endif
+  }
+  bool IsValid (void) const
+  {
+    return m_fd >= 0;
+  }
+  void Start (void)
+  {
+#ifdef __linux__
+    if (m_fd >= 0)
+      {
+        ioctl (m_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl (m_fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+#endif
+  }
+  uint64_t Stop (void)
+  {
+    uint64_t value = 0;
+#ifdef __linux__
+    if (m_fd >= 0)
+      {
+        ioctl (m_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read (m_fd, &value, sizeof (value)) != sizeof (value))
+          {
+            value = 0;
+          }
+      }
+#endif
+    return value;
+  }
+private:
+  int m_fd;
+};
+
+// Wall time plus cycles and LLC misses for one measured section.
+struct Sample
+{
+  double seconds;
+  uint64_t cycles;
+  uint64_t llcMisses;
+  bool counters;
+};
+
+class Probe
+{
+public:
+  Probe ()
+#ifdef __linux__
+    : m_cycles (PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES),
+      m_llc (PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES)
+#else
+    : m_cycles (0, 0),
+      m_llc (0, 0)
+#endif
+  {
+  }
+  void Start (void)
+  {
+    m_cycles.Start ();
+    m_llc.Start ();
+    m_start = WallSeconds ();
+  }
+  Sample Stop (void)
+  {
+    Sample s;
+    s.seconds = WallSeconds () - m_start;
+    s.cycles = m_cycles.Stop ();
+    s.llcMisses = m_llc.Stop ();
+    s.counters = m_cycles.IsValid () && m_llc.IsValid ();
+    return s;
+  }
+private:
+  PerfCounter m_cycles;
+  PerfCounter m_llc;
+  double m_start;
+};
+
+void
+WriteSample (std::ostream &os, const std::string &name, const Sample &s)
+{
+  os << "\"" << name << "\": {\"seconds\": " << s.seconds;
+  if (s.counters)
+    {
+      os << ", \"cycles\": " << s.cycles << ", \"llc_misses\": " << s.llcMisses;
+    }
+  os << "}";
+}
+
+Ipv4Address
+BenchAddress (uint32_t i)
+{
+  return Ipv4Address (0x0a000000 + i + 1);
+}
+
+// Builds the nodes of one topology into the table and returns the
+// transmission range to pass to UpdateRoute.
+double
+BuildTopology (const std::string &topology, uint32_t n, Ptr<ModRoutingTable> table,
+               Ptr<UniformRandomVariable> rng)
+{
+  // k-ary fat-tree: (k/2)^2 cores, k pods of k/2 aggregation and k/2 edge
+  // switches, k/2 hosts per edge switch; n is rounded down to a whole tree.
+  uint32_t k = 2;
+  if (topology == "fattree")
+    {
+      while (5 * (k + 2) * (k + 2) / 4 + (k + 2) * (k + 2) * (k + 2) / 4 <= n)
+        {
+          k += 2;
+        }
+      n = 5 * k * k / 4 + k * k * k / 4;
+    }
+
+  std::vector<Vector> pos (n);
+  double txRange = 1.0;
+  if (topology == "grid")
+    {
+      uint32_t side = std::ceil (std::sqrt ((double) n));
+      for (uint32_t i = 0; i < n; i++)
+        {
+          pos[i] = Vector (i % side, i / side, 0);
+        }
+    }
+  else if (topology == "geometric")
+    {
+      // square sized for an average degree of about 8
+      double side = std::sqrt (n * M_PI * txRange * txRange / 8.0);
+      for (uint32_t i = 0; i < n; i++)
+        {
+          pos[i] = Vector (rng->GetValue (0, side), rng->GetValue (0, side), 0);
+        }
+    }
+
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (pos[i]);
+      node->AggregateObject (mobility);
+      table->AddNode (node, BenchAddress (i));
+    }
+
+  if (topology == "fattree")
+    {
+      uint32_t half = k / 2;
+      uint32_t core = 0;
+      uint32_t agg = half * half;
+      uint32_t edge = agg + k * half;
+      uint32_t host = edge + k * half;
+      for (uint32_t p = 0; p < k; p++)
+        {
+          for (uint32_t a = 0; a < half; a++)
+            {
+              for (uint32_t c = 0; c < half; c++)
+                {
+                  table->AddLink (BenchAddress (agg + p * half + a), BenchAddress (core + a * half + c));
+                }
+              for (uint32_t e = 0; e < half; e++)
+                {
+                  table->AddLink (BenchAddress (agg + p * half + a), BenchAddress (edge + p * half + e));
+                }
+            }
+          for (uint32_t e = 0; e < half; e++)
+            {
+              for (uint32_t h = 0; h < half; h++)
+                {
+                  table->AddLink (BenchAddress (edge + p * half + e),
+                                  BenchAddress (host + (p * half + e) * half + h));
+                }
+            }
+        }
+    }
+  return txRange;
+}
+
+template <typename T>
+double
+TagRoundTrips (T &tag, uint32_t iterations)
+{
+  std::vector<uint8_t> buffer (tag.GetSerializedSize () + 8);
+  T copy;
+  double start = WallSeconds ();
+  for (uint32_t it = 0; it < iterations; it++)
+    {
+      tag.Serialize (TagBuffer (&buffer[0], &buffer[0] + buffer.size ()));
+      copy.Deserialize (TagBuffer (&buffer[0], &buffer[0] + buffer.size ()));
+    }
+  return iterations / (WallSeconds () - start);
+}
+
+std::vector<uint32_t>
+ParseSizes (const std::string &sizes)
+{
+  std::vector<uint32_t> result;
+  std::istringstream is (sizes);
+  std::string item;
+  while (std::getline (is, item, ','))
+    {
+      result.push_back (std::atoi (item.c_str ()));
+    }
+  return result;
+}
+
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string sizes = "100,200,500,1000,2000,5000,10000,20000";
+  std::string topologies = "geometric,grid,fattree";
+  std::string out = "-";
+  uint32_t maxNodes = 2000;
+  uint32_t lookups = 1000000;
+  uint32_t tagIterations = 1000000;
+  uint32_t staticRoutes = 100000;
+  bool hugePages = false;
+  std::string algorithm = "Auto";
+  std::string mode = "Eager";
+
+  CommandLine cmd;
+  cmd.AddValue ("sizes", "Comma separated node counts", sizes);
+  cmd.AddValue ("topologies", "Comma separated subset of geometric,grid,fattree", topologies);
+  cmd.AddValue ("maxNodes", "Skip sizes above this (the all-pairs table is O(n^2) memory)", maxNodes);
+  cmd.AddValue ("lookups", "Route lookups per measurement", lookups);
+  cmd.AddValue ("tagIterations", "Serialize/deserialize round trips per tag type", tagIterations);
+  cmd.AddValue ("staticRoutes", "Host and subnet routes in the static route measurement", staticRoutes);
+  cmd.AddValue ("hugePages", "Set ModRoutingTable::HugePages", hugePages);
+  cmd.AddValue ("mode", "Set ModRoutingTable::Mode", mode);
+  cmd.AddValue ("algorithm", "Set ModRoutingTable::Algorithm (Auto, Bfs, MultiSourceBfs)", algorithm);
+  cmd.AddValue ("out", "JSON output file, - for stdout", out);
+  cmd.Parse (argc, argv);
+
+  std::ofstream file;
+  if (out != "-")
+    {
+      file.open (out.c_str ());
+    }
+  std::ostream &os = (out != "-") ? file : std::cout;
+
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  os << "{\n  \"benchmark\": \"mod-routing-bench\",\n  \"routes\": [";
+
+  std::vector<uint32_t> sizeList = ParseSizes (sizes);
+  std::istringstream topoStream (topologies);
+  std::string topology;
+  bool first = true;
+  while (std::getline (topoStream, topology, ','))
+    {
+      for (uint32_t s = 0; s < sizeList.size (); s++)
+        {
+          uint32_t n = sizeList[s];
+          os << (first ? "\n" : ",\n") << "    {\"topology\": \"" << topology << "\", \"nodes\": " << n;
+          first = false;
+          if (n > maxNodes || n > 0xfffe)
+            {
+              os << ", \"skipped\": true}";
+              continue;
+            }
+
+          Ptr<ModRoutingTable> table = CreateObject<ModRoutingTable> ();
+          table->SetAttribute ("HugePages", BooleanValue (hugePages));
+          table->SetAttribute ("Algorithm", StringValue (algorithm));
+          table->SetAttribute ("Mode", StringValue (mode));
+          double txRange = BuildTopology (topology, n, table, rng);
+          n = table->GetNNodes ();
+
+          Probe probe;
+          probe.Start ();
+          table->UpdateRoute (txRange);
+          Sample build = probe.Stop ();
+
+          // same topology again, into the matrices kept from the first build
+          probe.Start ();
+          table->UpdateRoute (txRange);
+          Sample rebuild = probe.Stop ();
+
+          std::vector<uint32_t> src (lookups), dst (lookups), relay (lookups);
+          std::vector<double> dist (lookups);
+          for (uint32_t q = 0; q < lookups; q++)
+            {
+              src[q] = rng->GetInteger (0, n - 1);
+              dst[q] = rng->GetInteger (0, n - 1);
+            }
+
+          probe.Start ();
+          for (uint32_t q = 0; q < lookups; q++)
+            {
+              table->LookupRoute (table->GetAddress (src[q]), table->GetAddress (dst[q]));
+            }
+          Sample single = probe.Stop ();
+
+          probe.Start ();
+          table->LookupRouteBatch (&src[0], &dst[0], lookups, &relay[0], &dist[0]);
+          Sample batch = probe.Stop ();
+
+          os << ", \"edges_model\": \"" << (topology == "fattree" ? "links" : "range") << "\""
+             << ", \"algorithm\": \"" << (table->GetAlgorithm () == ModRoutingTable::MULTI_SOURCE_BFS ? "msbfs" : "bfs") << "\""
+             << ", \"partitions\": " << table->GetNPartitions ()
+             << ", \"table_bytes\": " << table->GetMemoryUsage ()
+             << ", \"peak_rss_kb\": " << PeakRssKb () << ", ";
+          WriteSample (os, "build", build);
+          os << ", ";
+          WriteSample (os, "rebuild", rebuild);
+          os << ", ";
+          WriteSample (os, "lookup", single);
+          os << ", \"lookups_per_second\": " << lookups / single.seconds << ", ";
+          WriteSample (os, "batch_lookup", batch);
+          os << ", \"batch_lookups_per_second\": " << lookups / batch.seconds << "}";
+          os.flush ();
+        }
+    }
+  os << "\n  ],\n  \"static_routes\": {";
+
+  // host routes under a /8 and one subnet route per 16 of them, matched
+  // by LookupRoute ahead of the (empty) computed table
+  Ptr<ModRoutingTable> statics = CreateObject<ModRoutingTable> ();
+  std::vector<Ipv4Address> staticDst (lookups);
+  Probe probe;
+  probe.Start ();
+  for (uint32_t r = 0; r < staticRoutes; r++)
+    {
+      Ipv4Address dst (0x0b000000 | rng->GetInteger (0, 0xffffff));
+      if (r % 16 == 0)
+        {
+          statics->AddRoute (Ipv4Address::GetAny (), BenchAddress (r % 1000), dst, Ipv4Mask (0xffffff00));
+        }
+      else
+        {
+          statics->AddRoute (Ipv4Address::GetAny (), BenchAddress (r % 1000), dst);
+        }
+    }
+  Sample staticBuild = probe.Stop ();
+  for (uint32_t q = 0; q < lookups; q++)
+    {
+      staticDst[q] = Ipv4Address (0x0b000000 | rng->GetInteger (0, 0xffffff));
+    }
+  probe.Start ();
+  for (uint32_t q = 0; q < lookups; q++)
+    {
+      statics->LookupRoute (BenchAddress (0), staticDst[q]);
+    }
+  Sample staticLookup = probe.Stop ();
+  os << "\"routes\": " << statics->GetNStaticRoutes ()
+     << ", \"table_bytes\": " << statics->GetMemoryUsage () << ", ";
+  WriteSample (os, "build", staticBuild);
+  os << ", ";
+  WriteSample (os, "lookup", staticLookup);
+  os << ", \"lookups_per_second\": " << lookups / staticLookup.seconds << "},";
+  os << "\n  \"tags\": {";
+
+  // MyTag logs every call to std::cout; keep that out of the results
+  std::streambuf *saved = std::cout.rdbuf ();
+  std::ostringstream sink;
+  std::cout.rdbuf (sink.rdbuf ());
+  MyTag myTag;
+  myTag.SetSimpleValue (std::vector<uint8_t> (10, 0));
+  double myTagRate = TagRoundTrips (myTag, tagIterations);
+  uint32_t myTagBytes = myTag.GetSerializedSize ();
+  std::cout.rdbuf (saved);
+
+  ModFailoverTag failover;
+  for (uint32_t k = 0; k < ModFailoverTag::MAX_ENTRIES; k++)
+    {
+      failover.SetCursor (k, 1);
+    }
+  double failoverRate = TagRoundTrips (failover, tagIterations);
+
+  ModSourceRouteTag srcRoute;
+  std::vector<uint32_t> path;
+  for (uint32_t k = 0; k < 12; k++)
+    {
+      path.push_back (k * 37);
+    }
+  srcRoute.SetPath (path, 1000);
+  double srcRouteRate = TagRoundTrips (srcRoute, tagIterations);
+
+  os << "\n    \"MyTag\": {\"bytes\": " << myTagBytes
+     << ", \"round_trips_per_second\": " << myTagRate << "},"
+     << "\n    \"ModFailoverTag\": {\"bytes\": " << failover.GetSerializedSize ()
+     << ", \"round_trips_per_second\": " << failoverRate << "},"
+     << "\n    \"ModSourceRouteTag\": {\"bytes\": " << srcRoute.GetSerializedSize ()
+     << ", \"round_trips_per_second\": " << srcRouteRate << "}"
+     << "\n  }\n}\n";
+
+  Simulator::Destroy ();
+  return 0;
+}
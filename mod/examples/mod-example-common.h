@@ -0,0 +1,198 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+// Shared by the mod examples: a BFS reference to check ModRoutingTable
+// against, and time/memory budgets that make a run fail on regressions.
+
+#ifndef MOD_EXAMPLE_COMMON_H
+#define MOD_EXAMPLE_COMMON_H
+
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <vector>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "ns3/core-module.h"
+#include "ns3/mod-routing-table.h"
+
+namespace ns3 {
+namespace modexample {
+
+typedef std::vector<std::vector<uint32_t> > Adjacency;
+
+inline double
+WallSeconds (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+inline double
+PeakRssMb (void)
+{
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+  return ru.ru_maxrss / 1024.0;
+}
+
+// Adjacency of nodes within txRange of each other.
+inline Adjacency
+RangeAdjacency (const std::vector<Vector> &pos, double txRange)
+{
+  Adjacency adj (pos.size ());
+  for (uint32_t i = 0; i < pos.size (); i++)
+    {
+      for (uint32_t j = i + 1; j < pos.size (); j++)
+        {
+          double d = CalculateDistance (pos[i], pos[j]);
+          if (d > 0 && d <= txRange)
+            {
+              adj[i].push_back (j);
+              adj[j].push_back (i);
+            }
+        }
+    }
+  return adj;
+}
+
+inline std::vector<uint32_t>
+BfsHops (const Adjacency &adj, uint32_t src)
+{
+  const uint32_t unreached = 0xffffffff;
+  std::vector<uint32_t> hops (adj.size (), unreached);
+  std::deque<uint32_t> queue;
+  hops[src] = 0;
+  queue.push_back (src);
+  while (!queue.empty ())
+    {
+      uint32_t u = queue.front ();
+      queue.pop_front ();
+      for (uint32_t k = 0; k < adj[u].size (); k++)
+        {
+          uint32_t v = adj[u][k];
+          if (hops[v] == unreached)
+            {
+              hops[v] = hops[u] + 1;
+              queue.push_back (v);
+            }
+        }
+    }
+  return hops;
+}
+
+// Compares the table with BFS for `sources` source nodes (all if 0):
+// hop distances must match and every next hop must be a neighbor one hop
+// closer to the destination.  Returns the number of wrong entries.
+inline uint32_t
+CheckRoutes (Ptr<ModRoutingTable> table, const std::vector<Ipv4Address> &addrs,
+             const Adjacency &adj, uint32_t sources)
+{
+  uint32_t n = addrs.size ();
+  uint32_t step = (sources == 0 || sources >= n) ? 1 : n / sources;
+  uint32_t errors = 0;
+  std::vector<std::vector<uint32_t> > hopsFrom (n);
+  for (uint32_t s = 0; s < n; s += step)
+    {
+      std::vector<uint32_t> hops = BfsHops (adj, s);
+      for (uint32_t d = 0; d < n; d++)
+        {
+          if (d == s)
+            {
+              continue;
+            }
+          double dist = table->GetDistance (addrs[s], addrs[d]);
+          Ipv4Address relay = table->LookupRoute (addrs[s], addrs[d]);
+          if (hops[d] == 0xffffffff)
+            {
+              errors += (relay != addrs[s] || table->IsReachable (addrs[s], addrs[d])) ? 1 : 0;
+              continue;
+            }
+          if (dist != hops[d])
+            {
+              errors++;
+              continue;
+            }
+          bool ok = false;
+          for (uint32_t k = 0; k < adj[s].size (); k++)
+            {
+              if (addrs[adj[s][k]] == relay)
+                {
+                  if (hopsFrom[d].empty ())
+                    {
+                      hopsFrom[d] = BfsHops (adj, d);
+                    }
+                  ok = hopsFrom[d][adj[s][k]] + 1 == hops[d];
+                  break;
+                }
+            }
+          errors += ok ? 0 : 1;
+        }
+    }
+  return errors;
+}
+
+// Fails the run when a measured cost exceeds its budget (0 disables).  The
+// budgets here depend on the scenario size, so they are given on the
+// command line; fixed ones are checked by the mod-routing test suite.
+class Budget
+{
+public:
+  Budget ()
+    : m_failed (false)
+  {
+  }
+  void Check (const char *what, double value, double limit, const char *unit)
+  {
+    std::cout << what << ": " << value << " " << unit;
+    if (limit > 0 && value > limit)
+      {
+        std::cout << " EXCEEDS budget " << limit;
+        m_failed = true;
+      }
+    std::cout << std::endl;
+  }
+  void Fail (void)
+  {
+    m_failed = true;
+  }
+  int ExitCode (void) const
+  {
+    return m_failed ? 1 : 0;
+  }
+private:
+  bool m_failed;
+};
+
+// Average wall time of a LookupRoute between random pairs, in ns.
+inline double
+TimeLookups (Ptr<ModRoutingTable> table, const std::vector<Ipv4Address> &addrs, uint32_t count)
+{
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  uint32_t n = addrs.size ();
+  double start = WallSeconds ();
+  for (uint32_t q = 0; q < count; q++)
+    {
+      table->LookupRoute (addrs[rng->GetInteger (0, n - 1)], addrs[rng->GetInteger (0, n - 1)]);
+    }
+  return (WallSeconds () - start) * 1e9 / count;
+}
+
+} // namespace modexample
+} // namespace ns3
+
+#endif /* MOD_EXAMPLE_COMMON_H */
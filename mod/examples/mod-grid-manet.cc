@@ -0,0 +1,239 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+// Static grid MANET routed by ModRouting.  All nodes share one
+// ModRoutingTable; the helper hands it to every ModRouting instance, each
+// node is registered with AddNode and UpdateRoute builds the routes once.
+//
+//   ./waf --run "mod-grid-manet --nodes=400 --flows=20 --verify=1"
+//
+// With --verify the table is checked against BFS and the build/lookup
+// cost against the given budgets; the exit code is non-zero on failure.
+// With --hierarchical the table keeps only per-cluster routes, and the
+// stretch of sampled routes is reported instead of checked against BFS.
+// With --groupSize a node also streams to a multicast group of that many
+// random members, along one tree instead of one unicast copy per member.
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/mod-routing-helper.h"
+#include "ns3/mod-routing-table.h"
+#include "mod-example-common.h"
+
+using namespace ns3;
+using namespace ns3::modexample;
+
+NS_LOG_COMPONENT_DEFINE ("ModGridManet");
+
+static uint32_t g_received = 0;
+static uint32_t g_stretchSamples = 0;
+static double g_stretchSum = 0;
+static double g_maxStretch = 0;
+
+static void
+RxSink (Ptr<const Packet> p, const Address &from)
+{
+  g_received++;
+}
+
+static void
+Stretch (uint32_t src, uint32_t dst, double stretch)
+{
+  g_stretchSamples++;
+  g_stretchSum += stretch;
+  g_maxStretch = std::max (g_maxStretch, stretch);
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nodes = 100;
+  uint32_t flows = 10;
+  double spacing = 100.0;
+  double txRange = 150.0;
+  double simTime = 10.0;
+  bool verify = false;
+  uint32_t verifySources = 32;
+  double buildBudget = 0;
+  double lookupBudget = 0;
+  bool hierarchical = false;
+  double memoryBudget = 0;
+  uint32_t groupSize = 0;
+  bool steiner = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("nodes", "Number of nodes (laid out on a square grid)", nodes);
+  cmd.AddValue ("flows", "Number of CBR flows between random pairs", flows);
+  cmd.AddValue ("spacing", "Grid spacing in meters", spacing);
+  cmd.AddValue ("txRange", "Transmission range in meters", txRange);
+  cmd.AddValue ("simTime", "Simulation time in seconds", simTime);
+  cmd.AddValue ("hierarchical", "Use the Hierarchical table mode", hierarchical);
+  cmd.AddValue ("verify", "Check routes against BFS and costs against the budgets", verify);
+  cmd.AddValue ("verifySources", "Source nodes to check (0 for all)", verifySources);
+  cmd.AddValue ("buildBudget", "Max seconds for UpdateRoute (0 for none)", buildBudget);
+  cmd.AddValue ("lookupBudget", "Max ns per LookupRoute (0 for none)", lookupBudget);
+  cmd.AddValue ("memoryBudget", "Max peak RSS in MB (0 for none)", memoryBudget);
+  cmd.AddValue ("groupSize", "Members of a multicast group streamed to by node 0 (0 for none)", groupSize);
+  cmd.AddValue ("steiner", "Build Steiner trees instead of shortest-path trees", steiner);
+  cmd.Parse (argc, argv);
+
+  NodeContainer c;
+  c.Create (nodes);
+
+  uint32_t side = std::ceil (std::sqrt ((double) nodes));
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                 "DeltaX", DoubleValue (spacing),
+                                 "DeltaY", DoubleValue (spacing),
+                                 "GridWidth", UintegerValue (side),
+                                 "LayoutType", StringValue ("RowFirst"));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (c);
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                "DataMode", StringValue ("DsssRate11Mbps"),
+                                "ControlMode", StringValue ("DsssRate1Mbps"));
+  YansWifiChannelHelper channel;
+  channel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  channel.AddPropagationLoss ("ns3::RangePropagationLossModel", "MaxRange", DoubleValue (txRange));
+  YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+  phy.SetChannel (channel.Create ());
+  WifiMacHelper mac;
+  mac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (phy, mac, c);
+
+  Ptr<ModRoutingTable> table = CreateObject<ModRoutingTable> ();
+  if (hierarchical)
+    {
+      table->SetAttribute ("Mode", StringValue ("Hierarchical"));
+      table->SetAttribute ("StretchSamples", UintegerValue (1000));
+      table->TraceConnectWithoutContext ("Stretch", MakeCallback (&Stretch));
+    }
+  if (steiner)
+    {
+      table->SetAttribute ("MulticastMode", StringValue ("SteinerTree"));
+    }
+  ModRoutingHelper modRouting;
+  modRouting.Set ("RoutingTable", PointerValue (table));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (modRouting);
+  stack.Install (c);
+
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.0.0", "255.255.0.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+  std::vector<Ipv4Address> addrs;
+  std::vector<Vector> pos;
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      table->AddNode (c.Get (i), interfaces.GetAddress (i));
+      addrs.push_back (interfaces.GetAddress (i));
+      pos.push_back (c.Get (i)->GetObject<MobilityModel> ()->GetPosition ());
+    }
+
+  double start = WallSeconds ();
+  table->UpdateRoute (txRange);
+  double buildSeconds = WallSeconds () - start;
+  std::cout << "partitions: " << table->GetNPartitions () << std::endl;
+  std::cout << "table bytes: " << table->GetMemoryUsage () << std::endl;
+  if (g_stretchSamples > 0)
+    {
+      std::cout << "stretch: mean " << g_stretchSum / g_stretchSamples << " max " << g_maxStretch << std::endl;
+    }
+
+  Budget budget;
+  if (verify && hierarchical)
+    {
+      budget.Check ("build", buildSeconds, buildBudget, "s");
+      budget.Check ("lookup", TimeLookups (table, addrs, 100000), lookupBudget, "ns");
+    }
+  if (verify && !hierarchical)
+    {
+      uint32_t errors = CheckRoutes (table, addrs, RangeAdjacency (pos, txRange), verifySources);
+      std::cout << "route errors: " << errors << std::endl;
+      if (errors > 0)
+        {
+          budget.Fail ();
+        }
+      budget.Check ("build", buildSeconds, buildBudget, "s");
+      budget.Check ("lookup", TimeLookups (table, addrs, 100000), lookupBudget, "ns");
+    }
+
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  for (uint32_t f = 0; f < flows; f++)
+    {
+      uint16_t port = 9 + f;
+      uint32_t src = rng->GetInteger (0, nodes - 1);
+      uint32_t dst = rng->GetInteger (0, nodes - 1);
+      if (src == dst)
+        {
+          continue;
+        }
+      PacketSinkHelper sink ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      ApplicationContainer sinkApp = sink.Install (c.Get (dst));
+      sinkApp.Start (Seconds (0.0));
+      OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress (addrs[dst], port));
+      onoff.SetConstantRate (DataRate ("64kbps"), 512);
+      ApplicationContainer app = onoff.Install (c.Get (src));
+      app.Start (Seconds (1.0 + rng->GetValue (0, 1)));
+      app.Stop (Seconds (simTime));
+    }
+  if (groupSize > 0)
+    {
+      Ipv4Address group ("225.1.1.1");
+      uint16_t port = 5000;
+      uint32_t unicastHops = 0;
+      PacketSinkHelper sink ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      for (uint32_t k = 0; k < groupSize; k++)
+        {
+          uint32_t member = rng->GetInteger (1, nodes - 1);
+          if (table->IsGroupMember (group, addrs[member]))
+            {
+              continue;
+            }
+          table->JoinGroup (group, addrs[member]);
+          unicastHops += table->GetPath (addrs[0], addrs[member]).size ();
+          sink.Install (c.Get (member)).Start (Seconds (0.0));
+        }
+      std::cout << "multicast tree links: " << table->GetMulticastTreeSize (addrs[0], group)
+                << " (unicast hops " << unicastHops << ")" << std::endl;
+      OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress (group, port));
+      onoff.SetConstantRate (DataRate ("64kbps"), 512);
+      ApplicationContainer app = onoff.Install (c.Get (0));
+      app.Start (Seconds (1.0));
+      app.Stop (Seconds (simTime));
+    }
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::PacketSink/Rx",
+                                 MakeCallback (&RxSink));
+
+  Simulator::Stop (Seconds (simTime));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  std::cout << "received packets: " << g_received << std::endl;
+  if (verify)
+    {
+      budget.Check ("peak rss", PeakRssMb (), memoryBudget, "MB");
+    }
+  return budget.ExitCode ();
+}
@@ -0,0 +1,279 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+// Random waypoint MANET routed by ModRouting.  The shared table is rebuilt
+// every --updateInterval seconds from the current node positions.
+//
+//   ./waf --run "mod-random-waypoint --nodes=200 --speed=10 --verify=1"
+//
+// With --verify every rebuild is checked against BFS, and the slowest
+// rebuild and the lookup cost against the budgets.  With --kinetic the
+// table is built once and then repaired only when a pair of nodes crosses
+// the transmission range.  With --ns2Trace the nodes follow an ns-2
+// movement file instead, and the routes for the whole run are precomputed
+// from it before the simulation starts.  With --geographic no routes are
+// kept at all; packets are forwarded greedily by position (GPSR).
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/mod-routing-helper.h"
+#include "ns3/mod-routing-table.h"
+#include "mod-example-common.h"
+
+using namespace ns3;
+using namespace ns3::modexample;
+
+NS_LOG_COMPONENT_DEFINE ("ModRandomWaypoint");
+
+struct Scenario
+{
+  Ptr<ModRoutingTable> table;
+  NodeContainer nodes;
+  std::vector<Ipv4Address> addrs;
+  double txRange;
+  Time interval;
+  bool kinetic;
+  bool timeline;
+  bool geographic;
+  bool verify;
+  uint32_t verifySources;
+  uint32_t errors;
+  double slowestBuild;
+  uint32_t rebuilds;
+  uint32_t received;
+};
+
+static Scenario g_scenario;
+
+static void
+RxSink (Ptr<const Packet> p, const Address &from)
+{
+  g_scenario.received++;
+}
+
+static void
+Check (void)
+{
+  Scenario &s = g_scenario;
+  if (s.verify && !s.geographic)
+    {
+      std::vector<Vector> pos;
+      for (uint32_t i = 0; i < s.nodes.GetN (); i++)
+        {
+          pos.push_back (s.nodes.Get (i)->GetObject<MobilityModel> ()->GetPosition ());
+        }
+      s.errors += CheckRoutes (s.table, s.addrs, RangeAdjacency (pos, s.txRange), s.verifySources);
+    }
+  NS_LOG_INFO (Simulator::Now ().GetSeconds () << "s: " << s.table->GetNPartitions () << " partition(s)");
+  if (s.timeline)
+    {
+      Simulator::Schedule (s.interval, &Check);
+    }
+}
+
+static void
+Rebuild (void)
+{
+  Scenario &s = g_scenario;
+  double start = WallSeconds ();
+  s.table->UpdateRoute (s.txRange);
+  s.slowestBuild = std::max (s.slowestBuild, WallSeconds () - start);
+  s.rebuilds++;
+  Check ();
+  if (!s.kinetic && !s.geographic)
+    {
+      Simulator::Schedule (s.interval, &Rebuild);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nodes = 100;
+  uint32_t flows = 10;
+  double area = 1000.0;
+  double speed = 5.0;
+  double pause = 1.0;
+  double simTime = 30.0;
+  double updateInterval = 1.0;
+  double buildBudget = 0;
+  double lookupBudget = 0;
+  double memoryBudget = 0;
+  std::string ns2Trace;
+
+  g_scenario.txRange = 250.0;
+  g_scenario.kinetic = false;
+  g_scenario.geographic = false;
+  g_scenario.verify = false;
+  g_scenario.verifySources = 16;
+
+  CommandLine cmd;
+  cmd.AddValue ("nodes", "Number of nodes", nodes);
+  cmd.AddValue ("flows", "Number of CBR flows between random pairs", flows);
+  cmd.AddValue ("area", "Side of the square area in meters", area);
+  cmd.AddValue ("speed", "Node speed in m/s", speed);
+  cmd.AddValue ("pause", "Pause time at each waypoint in seconds", pause);
+  cmd.AddValue ("txRange", "Transmission range in meters", g_scenario.txRange);
+  cmd.AddValue ("simTime", "Simulation time in seconds", simTime);
+  cmd.AddValue ("updateInterval", "Seconds between route table rebuilds", updateInterval);
+  cmd.AddValue ("kinetic", "Repair routes at predicted range crossings instead of every updateInterval",
+                g_scenario.kinetic);
+  cmd.AddValue ("geographic", "Forward by position instead of keeping routes", g_scenario.geographic);
+  cmd.AddValue ("ns2Trace", "ns-2 movement file; routes are then precomputed for the whole run", ns2Trace);
+  cmd.AddValue ("verify", "Check routes against BFS and costs against the budgets", g_scenario.verify);
+  cmd.AddValue ("verifySources", "Source nodes to check per rebuild (0 for all)", g_scenario.verifySources);
+  cmd.AddValue ("buildBudget", "Max seconds for one UpdateRoute (0 for none)", buildBudget);
+  cmd.AddValue ("lookupBudget", "Max ns per LookupRoute (0 for none)", lookupBudget);
+  cmd.AddValue ("memoryBudget", "Max peak RSS in MB (0 for none)", memoryBudget);
+  cmd.Parse (argc, argv);
+  g_scenario.timeline = !ns2Trace.empty ();
+
+  g_scenario.nodes.Create (nodes);
+
+  std::ostringstream bound;
+  bound << "ns3::UniformRandomVariable[Min=0.0|Max=" << area << "]";
+  ObjectFactory positions;
+  positions.SetTypeId ("ns3::RandomRectanglePositionAllocator");
+  positions.Set ("X", StringValue (bound.str ()));
+  positions.Set ("Y", StringValue (bound.str ()));
+  Ptr<PositionAllocator> allocator = positions.Create ()->GetObject<PositionAllocator> ();
+
+  std::ostringstream speedVar, pauseVar;
+  speedVar << "ns3::ConstantRandomVariable[Constant=" << speed << "]";
+  pauseVar << "ns3::ConstantRandomVariable[Constant=" << pause << "]";
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator (allocator);
+  mobility.SetMobilityModel ("ns3::RandomWaypointMobilityModel",
+                             "Speed", StringValue (speedVar.str ()),
+                             "Pause", StringValue (pauseVar.str ()),
+                             "PositionAllocator", PointerValue (allocator));
+  if (g_scenario.timeline)
+    {
+      Ns2MobilityHelper ns2 (ns2Trace);
+      ns2.Install ();
+    }
+  else
+    {
+      mobility.Install (g_scenario.nodes);
+    }
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                "DataMode", StringValue ("DsssRate11Mbps"),
+                                "ControlMode", StringValue ("DsssRate1Mbps"));
+  YansWifiChannelHelper channel;
+  channel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  channel.AddPropagationLoss ("ns3::RangePropagationLossModel",
+                              "MaxRange", DoubleValue (g_scenario.txRange));
+  YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+  phy.SetChannel (channel.Create ());
+  WifiMacHelper mac;
+  mac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (phy, mac, g_scenario.nodes);
+
+  g_scenario.table = CreateObject<ModRoutingTable> ();
+  g_scenario.table->SetAttribute ("Kinetic", BooleanValue (g_scenario.kinetic));
+  if (g_scenario.geographic)
+    {
+      g_scenario.table->SetAttribute ("Mode", StringValue ("Geographic"));
+    }
+  ModRoutingHelper modRouting;
+  modRouting.Set ("RoutingTable", PointerValue (g_scenario.table));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (modRouting);
+  stack.Install (g_scenario.nodes);
+
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.0.0", "255.255.0.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      g_scenario.table->AddNode (g_scenario.nodes.Get (i), interfaces.GetAddress (i));
+      g_scenario.addrs.push_back (interfaces.GetAddress (i));
+    }
+
+  g_scenario.interval = Seconds (updateInterval);
+  g_scenario.errors = 0;
+  g_scenario.slowestBuild = 0;
+  g_scenario.rebuilds = 0;
+  g_scenario.received = 0;
+  if (g_scenario.timeline)
+    {
+      double start = WallSeconds ();
+      if (!g_scenario.table->LoadNs2Trace (ns2Trace))
+        {
+          return 1;
+        }
+      g_scenario.table->PrecomputeTimeline (g_scenario.txRange, Seconds (simTime));
+      std::cout << "timeline: " << g_scenario.table->GetNTimelineSteps () << " topologies in "
+                << WallSeconds () - start << " s" << std::endl;
+      Simulator::ScheduleNow (&Check);
+    }
+  else
+    {
+      Simulator::ScheduleNow (&Rebuild);
+    }
+
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  for (uint32_t f = 0; f < flows; f++)
+    {
+      uint16_t port = 9 + f;
+      uint32_t src = rng->GetInteger (0, nodes - 1);
+      uint32_t dst = rng->GetInteger (0, nodes - 1);
+      if (src == dst)
+        {
+          continue;
+        }
+      PacketSinkHelper sink ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      sink.Install (g_scenario.nodes.Get (dst)).Start (Seconds (0.0));
+      OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress (g_scenario.addrs[dst], port));
+      onoff.SetConstantRate (DataRate ("64kbps"), 512);
+      ApplicationContainer app = onoff.Install (g_scenario.nodes.Get (src));
+      app.Start (Seconds (1.0 + rng->GetValue (0, 1)));
+      app.Stop (Seconds (simTime));
+    }
+  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::PacketSink/Rx",
+                                 MakeCallback (&RxSink));
+
+  Simulator::Stop (Seconds (simTime));
+  Simulator::Run ();
+
+  std::cout << "rebuilds: " << g_scenario.rebuilds + g_scenario.table->GetNScheduledUpdates () << std::endl;
+  if (g_scenario.kinetic)
+    {
+      std::cout << "range crossings: " << g_scenario.table->GetNCrossings () << std::endl;
+    }
+  std::cout << "received packets: " << g_scenario.received << std::endl;
+  Budget budget;
+  if (g_scenario.verify)
+    {
+      std::cout << "route errors: " << g_scenario.errors << std::endl;
+      if (g_scenario.errors > 0)
+        {
+          budget.Fail ();
+        }
+      budget.Check ("slowest build", g_scenario.slowestBuild, buildBudget, "s");
+      budget.Check ("lookup", TimeLookups (g_scenario.table, g_scenario.addrs, 100000), lookupBudget, "ns");
+      budget.Check ("peak rss", PeakRssMb (), memoryBudget, "MB");
+    }
+  Simulator::Destroy ();
+  return budget.ExitCode ();
+}
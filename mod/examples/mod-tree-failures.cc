@@ -0,0 +1,208 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+// Multi-rooted tree (spines over leaf switches over hosts) described to
+// ModRoutingTable with AddLink.  Random leaf-spine links fail one per
+// second; after each failure the table is rebuilt and compared with BFS,
+// and the number of host pairs that lost their path is reported.
+//
+//   ./waf --run "mod-tree-failures --spines=8 --leaves=32 --hosts=16 --verify=1"
+//
+// With --evalSamples the failover policy is also evaluated offline on the
+// intact tree, for --evalFailures random link failures per sample.
+// --mode=Aggregated keeps rows only for the switches, with each host
+// answered through its leaf switch; compare the table bytes with Eager.
+
+#include <algorithm>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mod-routing-table.h"
+#include "ns3/mod-failover-evaluator.h"
+#include "mod-example-common.h"
+
+using namespace ns3;
+using namespace ns3::modexample;
+
+NS_LOG_COMPONENT_DEFINE ("ModTreeFailures");
+
+struct Scenario
+{
+  Ptr<ModRoutingTable> table;
+  std::vector<Ipv4Address> addrs;
+  Adjacency adj;
+  std::vector<std::pair<uint32_t, uint32_t> > uplinks;
+  uint32_t hostBase;
+  bool verify;
+  uint32_t verifySources;
+  uint32_t errors;
+  double slowestBuild;
+};
+
+static Scenario g_scenario;
+
+static void
+RemoveEdge (Adjacency &adj, uint32_t a, uint32_t b)
+{
+  adj[a].erase (std::find (adj[a].begin (), adj[a].end (), b));
+  adj[b].erase (std::find (adj[b].begin (), adj[b].end (), a));
+}
+
+static void
+FailLink (uint32_t index)
+{
+  Scenario &s = g_scenario;
+  uint32_t a = s.uplinks[index].first;
+  uint32_t b = s.uplinks[index].second;
+  s.table->RemoveLink (s.addrs[a], s.addrs[b]);
+  RemoveEdge (s.adj, a, b);
+
+  double start = WallSeconds ();
+  s.table->UpdateRoute (0);
+  s.slowestBuild = std::max (s.slowestBuild, WallSeconds () - start);
+
+  uint32_t lost = 0;
+  uint32_t hosts = s.addrs.size () - s.hostBase;
+  for (uint32_t h = s.hostBase; h < s.addrs.size (); h += std::max<uint32_t> (1, hosts / 64))
+    {
+      for (uint32_t d = s.hostBase; d < s.addrs.size (); d++)
+        {
+          lost += s.table->IsReachable (s.addrs[h], s.addrs[d]) ? 0 : 1;
+        }
+    }
+  if (s.verify)
+    {
+      s.errors += CheckRoutes (s.table, s.addrs, s.adj, s.verifySources);
+    }
+  std::cout << Simulator::Now ().GetSeconds () << "s: link " << a << "-" << b << " down, "
+            << s.table->GetNPartitions () << " partition(s), "
+            << lost << " sampled host pairs unreachable" << std::endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t spines = 4;
+  uint32_t leaves = 8;
+  uint32_t hosts = 8;
+  uint32_t failures = 10;
+  double buildBudget = 0;
+  double lookupBudget = 0;
+  double memoryBudget = 0;
+  uint32_t evalFailures = 2;
+  uint32_t evalSamples = 0;
+  std::string mode = "Eager";
+  g_scenario.verify = false;
+  g_scenario.verifySources = 32;
+
+  CommandLine cmd;
+  cmd.AddValue ("spines", "Number of root (spine) switches", spines);
+  cmd.AddValue ("leaves", "Number of leaf switches, each linked to every spine", leaves);
+  cmd.AddValue ("hosts", "Hosts per leaf switch", hosts);
+  cmd.AddValue ("failures", "Leaf-spine links to fail, one per second", failures);
+  cmd.AddValue ("verify", "Check routes against BFS and costs against the budgets", g_scenario.verify);
+  cmd.AddValue ("verifySources", "Source nodes to check per rebuild (0 for all)", g_scenario.verifySources);
+  cmd.AddValue ("buildBudget", "Max seconds for one UpdateRoute (0 for none)", buildBudget);
+  cmd.AddValue ("lookupBudget", "Max ns per LookupRoute (0 for none)", lookupBudget);
+  cmd.AddValue ("memoryBudget", "Max peak RSS in MB (0 for none)", memoryBudget);
+  cmd.AddValue ("evalFailures", "Links failed per offline failover sample", evalFailures);
+  cmd.AddValue ("evalSamples", "Offline failover samples (0 to skip)", evalSamples);
+  cmd.AddValue ("mode", "Set ModRoutingTable::Mode", mode);
+  cmd.Parse (argc, argv);
+
+  Scenario &s = g_scenario;
+  uint32_t n = spines + leaves + leaves * hosts;
+  s.hostBase = spines + leaves;
+  s.table = CreateObject<ModRoutingTable> ();
+  s.table->SetAttribute ("Mode", StringValue (mode));
+  s.adj.resize (n);
+  NodeContainer c;
+  c.Create (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      s.addrs.push_back (Ipv4Address (0x0a000000 + i + 1));
+      s.table->AddNode (c.Get (i), s.addrs[i]);
+    }
+
+  for (uint32_t l = 0; l < leaves; l++)
+    {
+      uint32_t leaf = spines + l;
+      for (uint32_t sp = 0; sp < spines; sp++)
+        {
+          s.table->AddLink (s.addrs[leaf], s.addrs[sp]);
+          s.adj[leaf].push_back (sp);
+          s.adj[sp].push_back (leaf);
+          s.uplinks.push_back (std::make_pair (leaf, sp));
+        }
+      for (uint32_t h = 0; h < hosts; h++)
+        {
+          uint32_t host = s.hostBase + l * hosts + h;
+          s.table->AddLink (s.addrs[leaf], s.addrs[host]);
+          s.adj[leaf].push_back (host);
+          s.adj[host].push_back (leaf);
+        }
+    }
+
+  double start = WallSeconds ();
+  s.table->UpdateRoute (0);
+  s.slowestBuild = WallSeconds () - start;
+  std::cout << "table bytes: " << s.table->GetMemoryUsage () << std::endl;
+  s.errors = s.verify ? CheckRoutes (s.table, s.addrs, s.adj, s.verifySources) : 0;
+
+  if (evalSamples > 0)
+    {
+      Ptr<ModFailoverEvaluator> eval = CreateObject<ModFailoverEvaluator> ();
+      eval->SetAttribute ("Failures", UintegerValue (evalFailures));
+      eval->SetAttribute ("Samples", UintegerValue (evalSamples));
+      start = WallSeconds ();
+      ModFailoverEvaluator::Result result = eval->Run (s.table);
+      std::cout << "offline failover, " << evalFailures << " failure(s) per sample, "
+                << WallSeconds () - start << "s:" << std::endl;
+      result.Print (std::cout);
+    }
+
+  // fail distinct uplinks in random order
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  std::vector<uint32_t> order (s.uplinks.size ());
+  for (uint32_t k = 0; k < order.size (); k++)
+    {
+      order[k] = k;
+    }
+  for (uint32_t k = 0; k < order.size (); k++)
+    {
+      std::swap (order[k], order[rng->GetInteger (k, order.size () - 1)]);
+    }
+  for (uint32_t f = 0; f < std::min<uint32_t> (failures, order.size ()); f++)
+    {
+      Simulator::Schedule (Seconds (f + 1), &FailLink, order[f]);
+    }
+
+  Simulator::Run ();
+
+  Budget budget;
+  if (s.verify)
+    {
+      std::cout << "route errors: " << s.errors << std::endl;
+      if (s.errors > 0)
+        {
+          budget.Fail ();
+        }
+      budget.Check ("slowest build", s.slowestBuild, buildBudget, "s");
+      budget.Check ("lookup", TimeLookups (s.table, s.addrs, 100000), lookupBudget, "ns");
+      budget.Check ("peak rss", PeakRssMb (), memoryBudget, "MB");
+    }
+  Simulator::Destroy ();
+  return budget.ExitCode ();
+}
@@ -0,0 +1,386 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <algorithm>
+#include <thread>
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "mod-failover-evaluator.h"
+#include "mod-failover-tag.h"
+
+NS_LOG_COMPONENT_DEFINE ("ModFailoverEvaluator");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ModFailoverEvaluator);
+
+typedef modcore::Graph<uint32_t, double> ModGraph;
+typedef std::pair<uint32_t, uint32_t> Link;
+
+static const uint32_t UNREACHED = 0xffffffff;
+
+double
+ModFailoverEvaluator::Result::GetDeliveryRatio (void) const
+{
+  return pairs > 0 ? (double) delivered / pairs : 0;
+}
+
+double
+ModFailoverEvaluator::Result::GetConnectedDeliveryRatio (void) const
+{
+  return connected > 0 ? (double) delivered / connected : 0;
+}
+
+double
+ModFailoverEvaluator::Result::GetLoopRate (void) const
+{
+  return pairs > 0 ? (double) looped / pairs : 0;
+}
+
+double
+ModFailoverEvaluator::Result::GetMeanStretch (void) const
+{
+  return delivered > 0 ? stretchSum / delivered : 0;
+}
+
+void
+ModFailoverEvaluator::Result::Print (std::ostream &os) const
+{
+  os << "pairs: " << pairs << " (" << connected << " still connected)" << std::endl
+     << "delivery ratio: " << GetDeliveryRatio ()
+     << " (" << GetConnectedDeliveryRatio () << " of connected pairs)" << std::endl
+     << "skipped: " << skipped << " (no connected pair found)" << std::endl
+     << "loop rate: " << GetLoopRate () << ", dropped: " << dropped << std::endl
+     << "stretch: mean " << GetMeanStretch () << ", max " << maxStretch << std::endl;
+}
+
+// Runs every m_stride-th sample starting at m_first; shares only read-only
+// state with the other workers.
+class ModFailoverEvaluator::Worker
+{
+public:
+  Worker (const ModFailoverEvaluator &eval, const ModGraph &graph,
+          const modcore::NextHopStore<uint32_t, double> &store, bool euclidean,
+          const std::vector<Link> &links, const std::vector<uint32_t> &component,
+          uint32_t first, uint32_t stride)
+    : m_eval (eval), m_graph (graph), m_store (store), m_euclidean (euclidean),
+      m_links (links), m_component (component), m_first (first), m_stride (stride),
+      m_state (0)
+  {
+    Result empty = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    m_result = empty;
+  }
+
+  void Run (void)
+  {
+    for (uint32_t s = m_first; s < m_eval.m_samples; s += m_stride)
+      {
+        m_state = ((uint64_t) m_eval.m_seed << 32) ^ (s * 0x9e3779b97f4a7c15ULL);
+        Sample ();
+      }
+  }
+
+  const Result& GetResult (void) const
+  {
+    return m_result;
+  }
+
+private:
+  // splitmix64
+  uint64_t Next (void)
+  {
+    uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+  uint32_t Uniform (uint32_t bound)
+  {
+    return Next () % bound;
+  }
+
+  bool IsFailed (uint32_t u, uint32_t v) const
+  {
+    return std::binary_search (m_failed.begin (), m_failed.end (), Link (std::min (u, v), std::max (u, v)));
+  }
+
+  void Sample (void)
+  {
+    uint32_t n = m_graph.GetN ();
+    m_failed.clear ();
+    if (m_eval.m_failures >= m_links.size ())
+      {
+        m_failed = m_links;
+      }
+    else
+      {
+        while (m_failed.size () < m_eval.m_failures)
+          {
+            Link l = m_links[Uniform (m_links.size ())];
+            if (std::find (m_failed.begin (), m_failed.end (), l) == m_failed.end ())
+              {
+                m_failed.push_back (l);
+              }
+          }
+        std::sort (m_failed.begin (), m_failed.end ());
+      }
+
+    for (uint32_t p = 0; p < m_eval.m_pairs; p++)
+      {
+        // a pair the table considers connected
+        uint32_t src = 0, dst = 0;
+        uint32_t tries;
+        for (tries = 0; tries < 100; tries++)
+          {
+            src = Uniform (n);
+            dst = Uniform (n);
+            if (src != dst && m_component[src] == m_component[dst])
+              {
+                break;
+              }
+          }
+        if (tries == 100)
+          {
+            m_result.skipped++;
+            continue;
+          }
+        Walk (src, dst);
+      }
+  }
+
+  uint32_t FirstHop (uint32_t u, uint32_t dst)
+  {
+    return m_store.IsValid () ? m_store.GetFirstHop (u, dst) : m_tree[u];
+  }
+
+  void Walk (uint32_t src, uint32_t dst)
+  {
+    m_result.pairs++;
+    uint32_t shortest = FailedHops (src, dst);
+    if (shortest != UNREACHED)
+      {
+        m_result.connected++;
+      }
+    if (!m_store.IsValid ())
+      {
+        // no matrices (lazy table): next hops from a tree rooted at dst
+        m_tree.resize (m_graph.GetN ());
+        m_treeDist.resize (m_graph.GetN ());
+        if (m_euclidean)
+          {
+            modcore::SingleSource<uint32_t, double, modcore::EuclideanMetric>::Run (m_graph, dst, &m_tree[0], &m_treeDist[0]);
+          }
+        else
+          {
+            modcore::SingleSource<uint32_t, double, modcore::HopCountMetric>::Run (m_graph, dst, &m_tree[0], &m_treeDist[0]);
+          }
+      }
+
+    ModFailoverTag tag;
+    uint32_t u = src;
+    for (uint32_t hops = 0; ; hops++)
+      {
+        if (u == dst)
+          {
+            double stretch = (double) hops / shortest;
+            m_result.delivered++;
+            m_result.stretchSum += stretch;
+            m_result.maxStretch = std::max (m_result.maxStretch, stretch);
+            return;
+          }
+        if (hops == m_eval.m_maxHops)
+          {
+            m_result.looped++;
+            return;
+          }
+        uint8_t cursor = tag.GetCursor (u);
+        uint32_t next = FirstHop (u, dst);
+        if (cursor == 0 && next != u && !IsFailed (u, next))
+          {
+            u = next;
+            continue;
+          }
+        // failover, as in ModRouting::FailoverInput
+        uint32_t devices = std::min<uint32_t> (m_graph.Degree (u), 255);
+        const uint32_t *nbr = m_graph.Begin (u);
+        bool found = false;
+        for (uint32_t tries = 0; tries < devices; tries++)
+          {
+            cursor = (uint8_t)((cursor % devices) + 1);
+            if (!IsFailed (u, nbr[cursor - 1]))
+              {
+                found = true;
+                break;
+              }
+          }
+        if (!found)
+          {
+            m_result.dropped++;
+            return;
+          }
+        tag.SetCursor (u, cursor);
+        u = nbr[cursor - 1];
+      }
+  }
+
+  // hop distance with the failed links removed
+  uint32_t FailedHops (uint32_t src, uint32_t dst)
+  {
+    m_hops.assign (m_graph.GetN (), UNREACHED);
+    m_queue.clear ();
+    m_hops[src] = 0;
+    m_queue.push_back (src);
+    for (size_t head = 0; head < m_queue.size (); head++)
+      {
+        uint32_t u = m_queue[head];
+        if (u == dst)
+          {
+            break;
+          }
+        for (const uint32_t *v = m_graph.Begin (u); v != m_graph.End (u); ++v)
+          {
+            if (m_hops[*v] == UNREACHED && !IsFailed (u, *v))
+              {
+                m_hops[*v] = m_hops[u] + 1;
+                m_queue.push_back (*v);
+              }
+          }
+      }
+    return m_hops[dst];
+  }
+
+  const ModFailoverEvaluator &m_eval;
+  const ModGraph &m_graph;
+  const modcore::NextHopStore<uint32_t, double> &m_store;
+  bool m_euclidean;
+  const std::vector<Link> &m_links;
+  const std::vector<uint32_t> &m_component;
+  uint32_t m_first;
+  uint32_t m_stride;
+  uint64_t m_state;
+  Result m_result;
+  std::vector<Link> m_failed;
+  std::vector<uint32_t> m_hops;
+  std::vector<uint32_t> m_queue;
+  std::vector<uint32_t> m_tree;
+  std::vector<double> m_treeDist;
+};
+
+TypeId
+ModFailoverEvaluator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ModFailoverEvaluator")
+    .SetParent<Object> ()
+    .AddConstructor<ModFailoverEvaluator> ()
+    .AddAttribute ("Failures", "Links failed in each sample.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&ModFailoverEvaluator::m_failures),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Samples", "Number of failure samples.",
+                   UintegerValue (1000),
+                   MakeUintegerAccessor (&ModFailoverEvaluator::m_samples),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Pairs", "Source/destination pairs walked per sample.",
+                   UintegerValue (100),
+                   MakeUintegerAccessor (&ModFailoverEvaluator::m_pairs),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MaxHops", "Hops after which a walk counts as a loop.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&ModFailoverEvaluator::m_maxHops),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Threads", "Worker threads, 0 for one per core.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ModFailoverEvaluator::m_threads),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Seed", "Seed of the failure and pair sampling.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&ModFailoverEvaluator::m_seed),
+                   MakeUintegerChecker<uint32_t> ())
+    ;
+  return tid;
+}
+
+ModFailoverEvaluator::ModFailoverEvaluator ()
+  : m_failures (1),
+    m_samples (1000),
+    m_pairs (100),
+    m_maxHops (64),
+    m_threads (0),
+    m_seed (1)
+{
+}
+
+ModFailoverEvaluator::Result
+ModFailoverEvaluator::Run (Ptr<ModRoutingTable> table) const
+{
+  NS_LOG_FUNCTION (m_failures << m_samples << m_pairs);
+  const ModGraph &graph = table->GetGraph ();
+  modcore::NextHopStore<uint32_t, double> store = table->GetNextHopStore ();
+  Result total = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  if (graph.GetN () < 2)
+    {
+      return total;
+    }
+
+  std::vector<Link> links;
+  for (uint32_t u = 0; u < graph.GetN (); u++)
+    {
+      for (const uint32_t *v = graph.Begin (u); v != graph.End (u); ++v)
+        {
+          if (u < *v)
+            {
+              links.push_back (Link (u, *v));
+            }
+        }
+    }
+  std::vector<uint32_t> component;
+  modcore::Components (graph, component);
+
+  uint32_t threads = m_threads > 0 ? m_threads : std::max (1u, std::thread::hardware_concurrency ());
+  threads = std::max (1u, std::min (threads, m_samples));
+  std::vector<Worker> workers;
+  for (uint32_t t = 0; t < threads; t++)
+    {
+      workers.push_back (Worker (*this, graph, store, table->GetMetric () == ModRoutingTable::EUCLIDEAN,
+                                 links, component, t, threads));
+    }
+  std::vector<std::thread> pool;
+  for (uint32_t t = 1; t < threads; t++)
+    {
+      pool.push_back (std::thread (&Worker::Run, &workers[t]));
+    }
+  workers[0].Run ();
+  for (uint32_t t = 0; t < pool.size (); t++)
+    {
+      pool[t].join ();
+    }
+
+  for (uint32_t t = 0; t < threads; t++)
+    {
+      const Result &r = workers[t].GetResult ();
+      total.pairs += r.pairs;
+      total.connected += r.connected;
+      total.delivered += r.delivered;
+      total.looped += r.looped;
+      total.dropped += r.dropped;
+      total.skipped += r.skipped;
+      total.stretchSum += r.stretchSum;
+      total.maxStretch = std::max (total.maxStretch, r.maxStretch);
+    }
+  return total;
+}
+
+} // namespace ns3
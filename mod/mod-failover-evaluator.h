@@ -0,0 +1,76 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MOD_FAILOVER_EVALUATOR_H
+#define MOD_FAILOVER_EVALUATOR_H
+
+#include <ostream>
+#include <vector>
+#include "ns3/object.h"
+#include "mod-routing-table.h"
+
+namespace ns3 {
+
+// Monte-Carlo estimate of how well ModRouting's failover copes with k
+// random link failures, without running the simulator.  Each sample fails
+// k links of the table's graph and walks packets between random pairs the
+// way RouteInput forwards them: the next hop from the (pre-failure) table
+// while its link is up, otherwise the next working device after the
+// packet's ModFailoverTag cursor, device k being the node's k-th neighbor.
+// Samples are spread over worker threads and seeded by their index, so
+// results do not depend on the thread count.
+class ModFailoverEvaluator : public Object
+{
+public:
+  struct Result
+  {
+    uint64_t pairs;        // walks, all pairs connected before the failures
+    uint64_t connected;    // of those, still connected after them
+    uint64_t delivered;
+    uint64_t looped;       // ran out of MaxHops
+    uint64_t dropped;      // no working device left
+    uint64_t skipped;      // no connected pair found for the walk, not in pairs
+    double stretchSum;     // hops taken / shortest hops, over delivered walks
+    double maxStretch;
+
+    double GetDeliveryRatio (void) const;
+    double GetConnectedDeliveryRatio (void) const;
+    double GetLoopRate (void) const;
+    double GetMeanStretch (void) const;
+    void Print (std::ostream &os) const;
+  };
+
+  static TypeId GetTypeId (void);
+
+  ModFailoverEvaluator ();
+
+  // Uses the graph and next hops of the table's last UpdateRoute.
+  Result Run (Ptr<ModRoutingTable> table) const;
+
+private:
+  class Worker;
+
+  uint32_t m_failures;
+  uint32_t m_samples;
+  uint32_t m_pairs;
+  uint32_t m_maxHops;
+  uint32_t m_threads;
+  uint32_t m_seed;
+};
+
+}
+
+#endif /* MOD_FAILOVER_EVALUATOR_H */
@@ -0,0 +1,178 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "ns3/log.h"
+#include "mod-failover-tag.h"
+
+NS_LOG_COMPONENT_DEFINE ("ModFailoverTag");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ModFailoverTag);
+
+TypeId
+ModFailoverTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ModFailoverTag")
+    .SetParent<Tag> ()
+    .AddConstructor<ModFailoverTag> ()
+    ;
+  return tid;
+}
+
+ModFailoverTag::ModFailoverTag ()
+{
+  Clear ();
+}
+
+TypeId
+ModFailoverTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+ModFailoverTag::GetSerializedSize (void) const
+{
+  return 1 + MAX_ENTRIES * (sizeof (uint32_t) + sizeof (uint8_t));
+}
+
+void
+ModFailoverTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_nEntries);
+  for (uint8_t k = 0; k < MAX_ENTRIES; k++)
+    {
+      i.WriteU32 (m_nodeId[k]);
+      i.WriteU8 (m_cursor[k]);
+    }
+}
+
+void
+ModFailoverTag::Deserialize (TagBuffer i)
+{
+  m_nEntries = i.ReadU8 ();
+  for (uint8_t k = 0; k < MAX_ENTRIES; k++)
+    {
+      m_nodeId[k] = i.ReadU32 ();
+      m_cursor[k] = i.ReadU8 ();
+    }
+}
+
+void
+ModFailoverTag::Print (std::ostream &os) const
+{
+  os << "failover=";
+  for (uint8_t k = 0; k < m_nEntries; k++)
+    {
+      os << m_nodeId[k] << ":" << (uint32_t) m_cursor[k] << " ";
+    }
+}
+
+uint8_t
+ModFailoverTag::GetCursor (uint32_t nodeId) const
+{
+  for (uint8_t k = 0; k < m_nEntries; k++)
+    {
+      if (m_nodeId[k] == nodeId)
+        {
+          return m_cursor[k];
+        }
+    }
+  return 0;
+}
+
+void
+ModFailoverTag::SetCursor (uint32_t nodeId, uint8_t cursor)
+{
+  uint8_t k;
+  for (k = 0; k < m_nEntries; k++)
+    {
+      if (m_nodeId[k] == nodeId)
+        {
+          break;
+        }
+    }
+
+  if (cursor == 0)
+    {
+      // back on the primary path, drop the slot
+      if (k < m_nEntries)
+        {
+          for (; k + 1 < m_nEntries; k++)
+            {
+              m_nodeId[k] = m_nodeId[k + 1];
+              m_cursor[k] = m_cursor[k + 1];
+            }
+          m_nEntries--;
+        }
+      return;
+    }
+
+  if (k == m_nEntries)
+    {
+      if (m_nEntries == MAX_ENTRIES)
+        {
+          // full: forget the oldest hop, it is furthest behind the packet
+          for (k = 0; k + 1 < MAX_ENTRIES; k++)
+            {
+              m_nodeId[k] = m_nodeId[k + 1];
+              m_cursor[k] = m_cursor[k + 1];
+            }
+          k = MAX_ENTRIES - 1;
+        }
+      else
+        {
+          m_nEntries++;
+        }
+      m_nodeId[k] = nodeId;
+    }
+  m_cursor[k] = cursor;
+}
+
+uint8_t
+ModFailoverTag::GetNEntries (void) const
+{
+  return m_nEntries;
+}
+
+void
+ModFailoverTag::Clear (void)
+{
+  m_nEntries = 0;
+  for (uint8_t k = 0; k < MAX_ENTRIES; k++)
+    {
+      m_nodeId[k] = 0;
+      m_cursor[k] = 0;
+    }
+}
+
+void
+ModFailoverTag::Update (Ptr<const Packet> p, ModFailoverTag &tag, bool present)
+{
+  if (present)
+    {
+      // Packet tags are metadata outside the copy-on-write buffer; replacing
+      // a fixed-size tag rewrites its bytes without touching the payload.
+      ConstCast<Packet> (p)->ReplacePacketTag (tag);
+    }
+  else
+    {
+      p->AddPacketTag (tag);
+    }
+}
+
+}
@@ -0,0 +1,62 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MOD_FAILOVER_TAG_H
+#define MOD_FAILOVER_TAG_H
+
+#include <stdint.h>
+#include "ns3/tag.h"
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+// Per-packet failover state: for each node that had to leave the primary
+// path, the device cursor it used last.  The layout is fixed (a count plus
+// MAX_ENTRIES slots) so the serialized size never changes and the tag can be
+// rewritten in place with Packet::ReplacePacketTag on every hop.
+class ModFailoverTag : public Tag
+{
+public:
+  static const uint8_t MAX_ENTRIES = 6;
+
+  ModFailoverTag ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  // cursor 0 means "on the primary path"; k means device k-1 was used
+  uint8_t GetCursor (uint32_t nodeId) const;
+  void SetCursor (uint32_t nodeId, uint8_t cursor);
+  uint8_t GetNEntries (void) const;
+  void Clear (void);
+
+  // Write the tag back onto a packet that is being forwarded.  The packet
+  // buffer is not touched, so no copy-on-write is triggered.
+  static void Update (Ptr<const Packet> p, ModFailoverTag &tag, bool present);
+
+private:
+  uint8_t  m_nEntries;
+  uint32_t m_nodeId[MAX_ENTRIES];
+  uint8_t  m_cursor[MAX_ENTRIES];
+};
+
+}
+
+#endif /* MOD_FAILOVER_TAG_H */
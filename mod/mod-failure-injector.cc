@@ -0,0 +1,298 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <sstream>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/ipv4.h"
+#include "mod-failure-injector.h"
+#include "mod-routing.h"
+
+NS_LOG_COMPONENT_DEFINE ("ModFailureInjector");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ModFailureInjector);
+
+static const char MAGIC[4] = { 'M', 'O', 'D', 'F' };
+static const uint32_t RECORD_SIZE = 18;
+
+TypeId
+ModFailureInjector::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ModFailureInjector")
+    .SetParent<Object> ()
+    .AddConstructor<ModFailureInjector> ()
+    .AddAttribute ("RoutingTable", "Shared table told about every event.",
+                   PointerValue (),
+                   MakePointerAccessor (&ModFailureInjector::m_table),
+                   MakePointerChecker<ModRoutingTable> ())
+    .AddAttribute ("TraceFile", "Failure schedule, text or binary.",
+                   StringValue (""),
+                   MakeStringAccessor (&ModFailureInjector::m_traceFile),
+                   MakeStringChecker ())
+    .AddAttribute ("BatchSize", "Events read and scheduled at a time.",
+                   UintegerValue (4096),
+                   MakeUintegerAccessor (&ModFailureInjector::m_batchSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    ;
+  return tid;
+}
+
+ModFailureInjector::ModFailureInjector ()
+  : m_batchSize (4096),
+    m_binary (false),
+    m_line (0),
+    m_nInjected (0)
+{
+}
+
+ModFailureInjector::~ModFailureInjector ()
+{
+}
+
+void
+ModFailureInjector::DoDispose (void)
+{
+  m_table = 0;
+  m_trace.close ();
+  Object::DoDispose ();
+}
+
+bool
+ModFailureInjector::Start (void)
+{
+  NS_LOG_FUNCTION (m_traceFile);
+  NS_ASSERT_MSG (m_table != 0, "ModFailureInjector needs a RoutingTable");
+  m_trace.open (m_traceFile.c_str (), std::ios::in | std::ios::binary);
+  if (!m_trace.is_open ())
+    {
+      NS_LOG_ERROR ("Cannot open " << m_traceFile);
+      return false;
+    }
+  char magic[4] = { 0, 0, 0, 0 };
+  m_trace.read (magic, 4);
+  m_binary = m_trace.gcount () == 4 && std::equal (magic, magic + 4, MAGIC);
+  if (!m_binary)
+    {
+      m_trace.clear ();
+      m_trace.seekg (0);
+    }
+  m_last = Simulator::Now ();
+  ScheduleBatch ();
+  return true;
+}
+
+uint64_t
+ModFailureInjector::GetNInjected (void) const
+{
+  return m_nInjected;
+}
+
+// Schedules up to BatchSize events, and a refill after the last of them.
+// Events at the same time keep their trace order, the refill runs after
+// them.
+void
+ModFailureInjector::ScheduleBatch (void)
+{
+  Time now = Simulator::Now ();
+  Event ev;
+  uint32_t k;
+  for (k = 0; k < m_batchSize && ReadEvent (ev); k++)
+    {
+      if (ev.time < m_last)
+        {
+          NS_LOG_WARN ("Event at " << ev.time.GetSeconds () << "s is out of order, injected at "
+                       << m_last.GetSeconds () << "s");
+          ev.time = m_last;
+        }
+      m_last = ev.time;
+      Simulator::Schedule (ev.time - now, &ModFailureInjector::Inject, this, ev);
+    }
+  NS_LOG_LOGIC (k << " events scheduled up to " << m_last.GetSeconds () << "s");
+  if (k == m_batchSize)
+    {
+      Simulator::Schedule (m_last - now, &ModFailureInjector::ScheduleBatch, this);
+    }
+  else
+    {
+      m_trace.close ();
+    }
+}
+
+void
+ModFailureInjector::Inject (Event ev)
+{
+  NS_LOG_FUNCTION ((ev.node ? "node " : "link ") << ev.addr1 << ev.addr2 << (ev.down ? "down" : "up"));
+  m_nInjected++;
+  if (ev.node)
+    {
+      // ModRouting reports the interfaces to the table itself; the direct
+      // call covers nodes running something else (or no stack at all)
+      Ptr<Node> node = m_table->GetNode (ev.addr1);
+      Ptr<Ipv4> ipv4 = node != 0 ? node->GetObject<Ipv4> () : Ptr<Ipv4> ();
+      for (uint32_t i = 1; ipv4 != 0 && i < ipv4->GetNInterfaces (); i++)
+        {
+          if (ev.down)
+            {
+              ipv4->SetDown (i);
+            }
+          else
+            {
+              ipv4->SetUp (i);
+            }
+        }
+      if (ev.down)
+        {
+          m_table->NotifyNodeDown (ev.addr1);
+        }
+      else
+        {
+          m_table->NotifyNodeUp (ev.addr1);
+        }
+      return;
+    }
+
+  Ipv4Address ends[2] = { ev.addr1, ev.addr2 };
+  for (uint32_t e = 0; e < 2; e++)
+    {
+      Ptr<Node> node = m_table->GetNode (ends[e]);
+      Ptr<Ipv4> ipv4 = node != 0 ? node->GetObject<Ipv4> () : Ptr<Ipv4> ();
+      Ptr<ModRouting> routing = ipv4 != 0 ? DynamicCast<ModRouting> (ipv4->GetRoutingProtocol ()) : Ptr<ModRouting> ();
+      if (routing == 0)
+        {
+          continue;
+        }
+      if (ev.down)
+        {
+          routing->NotifyNeighborDown (ends[1 - e]);
+        }
+      else
+        {
+          routing->NotifyNeighborUp (ends[1 - e]);
+        }
+    }
+  if (ev.down)
+    {
+      m_table->NotifyLinkDown (ev.addr1, ev.addr2);
+    }
+  else
+    {
+      m_table->NotifyLinkUp (ev.addr1, ev.addr2);
+    }
+}
+
+bool
+ModFailureInjector::ReadEvent (Event &ev)
+{
+  return m_trace.is_open () && (m_binary ? ReadBinary (ev) : ReadText (ev));
+}
+
+bool
+ModFailureInjector::ReadText (Event &ev)
+{
+  std::string line;
+  while (std::getline (m_trace, line))
+    {
+      m_line++;
+      std::string::size_type hash = line.find ('#');
+      if (hash != std::string::npos)
+        {
+          line.erase (hash);
+        }
+      std::istringstream is (line);
+      double seconds;
+      std::string kind, addr1, addr2, state;
+      if (!(is >> seconds))
+        {
+          continue;
+        }
+      is >> kind >> addr1;
+      if (kind == "link")
+        {
+          is >> addr2;
+        }
+      is >> state;
+      if ((kind != "link" && kind != "node") || (state != "up" && state != "down"))
+        {
+          NS_LOG_WARN (m_traceFile << ":" << m_line << ": cannot parse \"" << line << "\"");
+          continue;
+        }
+      ev.time = Seconds (seconds);
+      ev.node = kind == "node";
+      ev.down = state == "down";
+      ev.addr1 = Ipv4Address (addr1.c_str ());
+      ev.addr2 = ev.node ? Ipv4Address::GetZero () : Ipv4Address (addr2.c_str ());
+      return true;
+    }
+  return false;
+}
+
+bool
+ModFailureInjector::ReadBinary (Event &ev)
+{
+  uint8_t b[RECORD_SIZE];
+  m_trace.read (reinterpret_cast<char *> (b), RECORD_SIZE);
+  if (m_trace.gcount () != (std::streamsize) RECORD_SIZE)
+    {
+      return false;
+    }
+  uint64_t t = 0;
+  for (int k = 7; k >= 0; k--)
+    {
+      t = (t << 8) | b[k];
+    }
+  uint32_t a1 = b[10] | (b[11] << 8) | (b[12] << 16) | ((uint32_t) b[13] << 24);
+  uint32_t a2 = b[14] | (b[15] << 8) | (b[16] << 16) | ((uint32_t) b[17] << 24);
+  ev.time = NanoSeconds ((int64_t) t);
+  ev.node = b[8] != 0;
+  ev.down = b[9] != 0;
+  ev.addr1 = Ipv4Address (a1);
+  ev.addr2 = Ipv4Address (a2);
+  return true;
+}
+
+void
+ModFailureInjector::WriteBinaryHeader (std::ostream &os)
+{
+  os.write (MAGIC, 4);
+}
+
+void
+ModFailureInjector::WriteBinaryEvent (std::ostream &os, const Event &ev)
+{
+  uint8_t b[RECORD_SIZE];
+  uint64_t t = ev.time.GetNanoSeconds ();
+  uint32_t a1 = ev.addr1.Get ();
+  uint32_t a2 = ev.node ? 0 : ev.addr2.Get ();
+  for (int k = 0; k < 8; k++)
+    {
+      b[k] = (t >> (8 * k)) & 0xff;
+    }
+  b[8] = ev.node ? 1 : 0;
+  b[9] = ev.down ? 1 : 0;
+  for (int k = 0; k < 4; k++)
+    {
+      b[10 + k] = (a1 >> (8 * k)) & 0xff;
+      b[14 + k] = (a2 >> (8 * k)) & 0xff;
+    }
+  os.write (reinterpret_cast<const char *> (b), RECORD_SIZE);
+}
+
+} // namespace ns3
@@ -0,0 +1,90 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MOD_FAILURE_INJECTOR_H
+#define MOD_FAILURE_INJECTOR_H
+
+#include <fstream>
+#include <string>
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/ipv4-address.h"
+#include "mod-routing-table.h"
+
+namespace ns3 {
+
+// Replays a failure schedule into a running simulation.  The trace is read
+// BatchSize events at a time; the next batch is read when the simulation
+// reaches the last event of the current one, so memory does not grow with
+// the length of the trace.
+//
+// Text traces have one event per line, times in seconds, # for comments:
+//   1.5 link 10.0.0.1 10.0.0.2 down
+//   3.0 node 10.0.0.7 up
+// Binary traces start with "MODF" followed by 18-byte little-endian
+// records: int64 time (ns), uint8 kind (0 link, 1 node), uint8 down,
+// uint32 addr1, uint32 addr2 (0 for nodes).  Events must be in time order.
+//
+// A node event takes all the node's interfaces down (or up); a link event
+// tells both ends' ModRouting through NotifyNeighborDown/Up.  The shared
+// ModRoutingTable is told either way.
+class ModFailureInjector : public Object
+{
+public:
+  struct Event
+  {
+    Time time;
+    bool node;
+    bool down;
+    Ipv4Address addr1;
+    Ipv4Address addr2;
+  };
+
+  static TypeId GetTypeId (void);
+
+  ModFailureInjector ();
+  virtual ~ModFailureInjector ();
+
+  // Opens the TraceFile and schedules its first batch.
+  bool Start (void);
+  uint64_t GetNInjected (void) const;
+
+  static void WriteBinaryHeader (std::ostream &os);
+  static void WriteBinaryEvent (std::ostream &os, const Event &ev);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  bool ReadEvent (Event &ev);
+  bool ReadText (Event &ev);
+  bool ReadBinary (Event &ev);
+  void ScheduleBatch (void);
+  void Inject (Event ev);
+
+  Ptr<ModRoutingTable> m_table;
+  std::string m_traceFile;
+  uint32_t m_batchSize;
+  std::ifstream m_trace;
+  bool m_binary;
+  uint64_t m_line;
+  uint64_t m_nInjected;
+  Time m_last;
+};
+
+}
+
+#endif /* MOD_FAILURE_INJECTOR_H */
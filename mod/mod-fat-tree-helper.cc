@@ -0,0 +1,191 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/ipv4.h"
+#include "ns3/internet-stack-helper.h"
+#include "mod-fat-tree-helper.h"
+
+NS_LOG_COMPONENT_DEFINE ("ModFatTreeHelper");
+
+namespace ns3 {
+
+ModFatTreeHelper::ModFatTreeHelper (uint32_t k)
+  : Ipv4RoutingHelper (),
+    m_k (k)
+{
+  NS_ASSERT_MSG (k >= 2 && k <= 254 && k % 2 == 0, "fat-tree k must be even, from 2 to 254");
+  m_agentFactory.SetTypeId ("ns3::ModFatTreeRouting");
+  m_agentFactory.Set ("K", UintegerValue (k));
+}
+
+ModFatTreeHelper*
+ModFatTreeHelper::Copy (void) const
+{
+  return new ModFatTreeHelper (*this);
+}
+
+Ptr<Ipv4RoutingProtocol>
+ModFatTreeHelper::Create (Ptr<Node> node) const
+{
+  Ptr<ModFatTreeRouting> agent = m_agentFactory.Create<ModFatTreeRouting> ();
+  node->AggregateObject (agent);
+  return agent;
+}
+
+void
+ModFatTreeHelper::SetDeviceAttribute (std::string name, const AttributeValue &value)
+{
+  m_p2p.SetDeviceAttribute (name, value);
+}
+
+void
+ModFatTreeHelper::SetChannelAttribute (std::string name, const AttributeValue &value)
+{
+  m_p2p.SetChannelAttribute (name, value);
+}
+
+void
+ModFatTreeHelper::Install (void)
+{
+  NS_ASSERT_MSG (m_cores.GetN () == 0, "ModFatTreeHelper::Install called twice");
+  uint32_t half = m_k / 2;
+  m_cores.Create (half * half);
+  m_aggregations.Create (m_k * half);
+  m_edges.Create (m_k * half);
+  m_hosts.Create (m_k * half * half);
+
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (*this);
+  stack.Install (m_cores);
+  stack.Install (m_aggregations);
+  stack.Install (m_edges);
+  stack.Install (m_hosts);
+
+  // devices by node and port, linked first and added to Ipv4 in port order
+  std::vector<std::vector<Ptr<NetDevice> > > core (m_cores.GetN (), std::vector<Ptr<NetDevice> > (m_k));
+  std::vector<std::vector<Ptr<NetDevice> > > agg (m_aggregations.GetN (), std::vector<Ptr<NetDevice> > (m_k));
+  std::vector<std::vector<Ptr<NetDevice> > > edge (m_edges.GetN (), std::vector<Ptr<NetDevice> > (m_k));
+  std::vector<std::vector<Ptr<NetDevice> > > host (m_hosts.GetN (), std::vector<Ptr<NetDevice> > (1));
+  for (uint32_t p = 0; p < m_k; p++)
+    {
+      for (uint32_t s = 0; s < half; s++)
+        {
+          uint32_t a = p * half + s;
+          for (uint32_t c = 0; c < half; c++)
+            {
+              uint32_t g = s * half + c;
+              Link (m_aggregations.Get (a), agg[a], half + c, m_cores.Get (g), core[g], p);
+            }
+          for (uint32_t e = 0; e < half; e++)
+            {
+              Link (m_aggregations.Get (a), agg[a], e, m_edges.Get (p * half + e), edge[p * half + e], half + s);
+            }
+          for (uint32_t h = 0; h < half; h++)
+            {
+              uint32_t e = p * half + s;
+              Link (m_edges.Get (e), edge[e], h, m_hosts.Get (e * half + h), host[e * half + h], 0);
+            }
+        }
+    }
+
+  for (uint32_t g = 0; g < half; g++)
+    {
+      for (uint32_t c = 0; c < half; c++)
+        {
+          AddPorts (m_cores.Get (g * half + c), core[g * half + c], ModFatTreeRouting::GetCoreAddress (m_k, g, c));
+        }
+    }
+  for (uint32_t p = 0; p < m_k; p++)
+    {
+      for (uint32_t s = 0; s < half; s++)
+        {
+          uint32_t e = p * half + s;
+          AddPorts (m_aggregations.Get (e), agg[e], ModFatTreeRouting::GetAggregationAddress (m_k, p, s));
+          AddPorts (m_edges.Get (e), edge[e], ModFatTreeRouting::GetEdgeAddress (p, s));
+          for (uint32_t h = 0; h < half; h++)
+            {
+              AddPorts (m_hosts.Get (e * half + h), host[e * half + h], ModFatTreeRouting::GetHostAddress (p, s, h));
+            }
+        }
+    }
+  NS_LOG_INFO ("fat-tree k=" << m_k << ": " << m_hosts.GetN () << " hosts, "
+               << m_cores.GetN () + m_aggregations.GetN () + m_edges.GetN () << " switches");
+}
+
+void
+ModFatTreeHelper::Link (Ptr<Node> a, std::vector<Ptr<NetDevice> > &portsA, uint32_t portA,
+                        Ptr<Node> b, std::vector<Ptr<NetDevice> > &portsB, uint32_t portB)
+{
+  NetDeviceContainer devices = m_p2p.Install (a, b);
+  portsA[portA] = devices.Get (0);
+  portsB[portB] = devices.Get (1);
+}
+
+// The node's address goes on every port, as a /32: the routing needs no
+// per-link subnets.
+void
+ModFatTreeHelper::AddPorts (Ptr<Node> node, const std::vector<Ptr<NetDevice> > &ports, Ipv4Address address)
+{
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  for (uint32_t port = 0; port < ports.size (); port++)
+    {
+      uint32_t iface = ipv4->AddInterface (ports[port]);
+      NS_ASSERT_MSG (iface == port + 1, "fat-tree nodes must not have other interfaces");
+      ipv4->AddAddress (iface, Ipv4InterfaceAddress (address, Ipv4Mask::GetOnes ()));
+      ipv4->SetUp (iface);
+    }
+}
+
+uint32_t
+ModFatTreeHelper::GetK (void) const
+{
+  return m_k;
+}
+
+NodeContainer
+ModFatTreeHelper::GetHosts (void) const
+{
+  return m_hosts;
+}
+
+NodeContainer
+ModFatTreeHelper::GetEdges (void) const
+{
+  return m_edges;
+}
+
+NodeContainer
+ModFatTreeHelper::GetAggregations (void) const
+{
+  return m_aggregations;
+}
+
+NodeContainer
+ModFatTreeHelper::GetCores (void) const
+{
+  return m_cores;
+}
+
+Ptr<Node>
+ModFatTreeHelper::GetHost (uint32_t pod, uint32_t edge, uint32_t host) const
+{
+  uint32_t half = m_k / 2;
+  return m_hosts.Get ((pod * half + edge) * half + host);
+}
+
+} // namespace ns3
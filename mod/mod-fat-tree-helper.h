@@ -0,0 +1,77 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MOD_FAT_TREE_HELPER_H
+#define MOD_FAT_TREE_HELPER_H
+
+#include <vector>
+#include "ns3/object-factory.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device.h"
+#include "ns3/ipv4-routing-helper.h"
+#include "ns3/point-to-point-helper.h"
+#include "mod-fat-tree-routing.h"
+
+namespace ns3 {
+
+// Builds a k-ary fat-tree of point-to-point links, with the Internet stack,
+// ModFatTreeRouting on every node and the structured addresses it routes
+// by (see ModFatTreeRouting).  Interfaces are added in port order, so
+// interface p + 1 is port p.
+//
+//   ModFatTreeHelper fatTree (8);
+//   fatTree.SetDeviceAttribute ("DataRate", StringValue ("10Gbps"));
+//   fatTree.Install ();
+//   Ptr<Node> h = fatTree.GetHost (pod, edge, host);
+class ModFatTreeHelper : public Ipv4RoutingHelper
+{
+public:
+  explicit ModFatTreeHelper (uint32_t k = 4);
+
+  ModFatTreeHelper* Copy (void) const;
+  virtual Ptr<Ipv4RoutingProtocol> Create (Ptr<Node> node) const;
+
+  // Attributes of the point-to-point links.
+  void SetDeviceAttribute (std::string name, const AttributeValue &value);
+  void SetChannelAttribute (std::string name, const AttributeValue &value);
+
+  // Creates the nodes, links and addresses; once per helper.
+  void Install (void);
+
+  uint32_t GetK (void) const;
+  NodeContainer GetHosts (void) const;
+  NodeContainer GetEdges (void) const;
+  NodeContainer GetAggregations (void) const;
+  NodeContainer GetCores (void) const;
+  Ptr<Node> GetHost (uint32_t pod, uint32_t edge, uint32_t host) const;
+
+private:
+  void Link (Ptr<Node> a, std::vector<Ptr<NetDevice> > &portsA, uint32_t portA,
+             Ptr<Node> b, std::vector<Ptr<NetDevice> > &portsB, uint32_t portB);
+  static void AddPorts (Ptr<Node> node, const std::vector<Ptr<NetDevice> > &ports, Ipv4Address address);
+
+  uint32_t m_k;
+  ObjectFactory m_agentFactory;
+  PointToPointHelper m_p2p;
+  NodeContainer m_hosts;
+  NodeContainer m_edges;
+  NodeContainer m_aggregations;
+  NodeContainer m_cores;
+};
+
+} // namespace ns3
+
+#endif /* MOD_FAT_TREE_HELPER_H */
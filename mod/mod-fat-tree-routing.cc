@@ -0,0 +1,407 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/output-stream-wrapper.h"
+#include "mod-fat-tree-routing.h"
+
+NS_LOG_COMPONENT_DEFINE ("ModFatTreeRouting");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ModFatTreeRouting);
+
+static Ipv4Address
+TreeAddress (uint32_t pod, uint32_t sw, uint32_t id)
+{
+  return Ipv4Address ((10u << 24) | (pod << 16) | (sw << 8) | id);
+}
+
+// FNV-1a over the bytes of x
+static uint32_t
+HashWord (uint32_t h, uint32_t x)
+{
+  for (int k = 0; k < 4; k++)
+    {
+      h = (h ^ ((x >> (8 * k)) & 0xff)) * 16777619u;
+    }
+  return h;
+}
+
+// FNV's low bits are poorly mixed and ports are picked modulo small
+// counts, so finish with murmur3's avalanche
+static uint32_t
+HashFinish (uint32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+TypeId
+ModFatTreeRouting::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ModFatTreeRouting")
+    .SetParent<Ipv4RoutingProtocol> ()
+    .AddConstructor<ModFatTreeRouting> ()
+    .AddAttribute ("K", "Ports per switch of the fat-tree (even, at most 254).",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&ModFatTreeRouting::m_k),
+                   MakeUintegerChecker<uint32_t> (2, 254))
+    ;
+  return tid;
+}
+
+ModFatTreeRouting::ModFatTreeRouting ()
+  : m_k (4),
+    m_role (HOST),
+    m_pod (0),
+    m_switch (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+ModFatTreeRouting::~ModFatTreeRouting ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+Ipv4Address
+ModFatTreeRouting::GetHostAddress (uint32_t pod, uint32_t edge, uint32_t host)
+{
+  return TreeAddress (pod, edge, 2 + host);
+}
+
+Ipv4Address
+ModFatTreeRouting::GetEdgeAddress (uint32_t pod, uint32_t edge)
+{
+  return TreeAddress (pod, edge, 1);
+}
+
+Ipv4Address
+ModFatTreeRouting::GetAggregationAddress (uint32_t k, uint32_t pod, uint32_t agg)
+{
+  return TreeAddress (pod, k / 2 + agg, 1);
+}
+
+Ipv4Address
+ModFatTreeRouting::GetCoreAddress (uint32_t k, uint32_t group, uint32_t core)
+{
+  return TreeAddress (k, 1 + group, 1 + core);
+}
+
+Ptr<Ipv4Route>
+ModFatTreeRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif, Socket::SocketErrno &sockerr)
+{
+  // the transport header is added after the route is chosen
+  int32_t port = GetPort (header.GetDestination (), FlowHash (p, header, false));
+  if (port < 0)
+    {
+      NS_LOG_DEBUG ("No port towards " << header.GetDestination ());
+      sockerr = Socket::ERROR_NOROUTETOHOST;
+      return 0;
+    }
+  sockerr = Socket::ERROR_NOTERROR;
+  return MakeRoute (port, header, m_address);
+}
+
+bool
+ModFatTreeRouting::RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                               UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                               LocalDeliverCallback lcb, ErrorCallback ecb)
+{
+  NS_LOG_FUNCTION (header.GetDestination ());
+  if (header.GetDestination () == m_address)
+    {
+      lcb (p, header, m_ipv4->GetInterfaceForDevice (idev));
+      return true;
+    }
+  if (header.GetDestination ().IsBroadcast () || header.GetDestination ().IsMulticast ())
+    {
+      return false;
+    }
+  int32_t port = GetPort (header.GetDestination (), FlowHash (p, header, true));
+  if (port < 0)
+    {
+      NS_LOG_DEBUG ("No port towards " << header.GetDestination ());
+      ecb (p, header, Socket::ERROR_NOROUTETOHOST);
+      return true;
+    }
+  ucb (MakeRoute (port, header, header.GetSource ()), p, header);
+  return true;
+}
+
+ModFatTreeRouting::Role
+ModFatTreeRouting::GetRole (void) const
+{
+  return m_role;
+}
+
+int32_t
+ModFatTreeRouting::GetPort (Ipv4Address dst, uint32_t hash) const
+{
+  uint32_t a = dst.Get ();
+  uint32_t pod = (a >> 16) & 0xff, sw = (a >> 8) & 0xff, id = a & 0xff;
+  uint32_t half = m_k / 2;
+  bool core = pod == m_k;
+  bool valid = (a >> 24) == 10
+    && (core ? sw >= 1 && sw <= half && id >= 1 && id <= half
+        : pod < m_k && sw < m_k && (id == 1 || (id >= 2 && id < 2 + half && sw < half)));
+  if (!valid)
+    {
+      return -1;
+    }
+  bool toAgg = !core && sw >= half;
+  int32_t port = -1;
+  switch (m_role)
+    {
+    case HOST:
+      port = 0;
+      break;
+    case EDGE:
+      if (core)
+        {
+          port = half + sw - 1;
+        }
+      else if (pod == m_pod && toAgg)
+        {
+          port = sw;
+        }
+      else if (pod == m_pod && sw == m_switch && id >= 2)
+        {
+          port = id - 2;
+        }
+      else
+        {
+          return UpPort (hash);
+        }
+      break;
+    case AGGREGATION:
+      if (core)
+        {
+          if (sw - 1 != m_switch)
+            {
+              return DownPort (hash);
+            }
+          port = half + id - 1;
+        }
+      else if (pod != m_pod)
+        {
+          return UpPort (hash);
+        }
+      else if (toAgg)
+        {
+          return DownPort (hash);
+        }
+      else
+        {
+          port = sw;
+        }
+      break;
+    case CORE:
+      if (core)
+        {
+          return DownPort (hash);
+        }
+      port = pod;
+      break;
+    }
+  return IsPortUp (port) ? port : -1;
+}
+
+Ipv4Address
+ModFatTreeRouting::GetNeighbor (uint32_t port) const
+{
+  uint32_t half = m_k / 2;
+  switch (m_role)
+    {
+    case HOST:
+      return GetEdgeAddress (m_pod, m_switch);
+    case EDGE:
+      return port < half ? GetHostAddress (m_pod, m_switch, port) : GetAggregationAddress (m_k, m_pod, port - half);
+    case AGGREGATION:
+      return port < half ? GetEdgeAddress (m_pod, port) : GetCoreAddress (m_k, m_switch, port - half);
+    default:
+      return GetAggregationAddress (m_k, port, m_pod);
+    }
+}
+
+// Hash of the flow's addresses, protocol and, when the packet carries its
+// transport header (l4), TCP and UDP ports, which lead the payload then.
+// Salted with the node's own address so that successive stages do not
+// all split flows the same way.
+uint32_t
+ModFatTreeRouting::FlowHash (Ptr<const Packet> p, const Ipv4Header &header, bool l4) const
+{
+  uint8_t ports[4] = { 0, 0, 0, 0 };
+  uint8_t protocol = header.GetProtocol ();
+  if (l4 && p != 0 && (protocol == 6 || protocol == 17) && p->GetSize () >= 4)
+    {
+      p->CopyData (ports, 4);
+    }
+  uint32_t h = HashWord (2166136261u, m_address.Get ());
+  h = HashWord (h, header.GetSource ().Get ());
+  h = HashWord (h, header.GetDestination ().Get ());
+  h = HashWord (h, (protocol << 24) | (ports[0] << 16) | (ports[1] << 8) | ports[2]);
+  h = HashWord (h, ports[3]);
+  return HashFinish (h);
+}
+
+// ECMP over the up ports, or over the down ports for a detour through the
+// pod (aggregation) or a pod (core), skipping ports whose link is down.
+int32_t
+ModFatTreeRouting::UpPort (uint32_t hash) const
+{
+  uint32_t half = m_k / 2;
+  uint32_t live = 0;
+  for (uint32_t port = half; port < m_k; port++)
+    {
+      live += IsPortUp (port) ? 1 : 0;
+    }
+  for (uint32_t port = half, pick = live > 0 ? hash % live : 0; live > 0 && port < m_k; port++)
+    {
+      if (IsPortUp (port) && pick-- == 0)
+        {
+          return port;
+        }
+    }
+  return -1;
+}
+
+int32_t
+ModFatTreeRouting::DownPort (uint32_t hash) const
+{
+  uint32_t ports = m_role == CORE ? m_k : m_k / 2;
+  uint32_t live = 0;
+  for (uint32_t port = 0; port < ports; port++)
+    {
+      live += IsPortUp (port) ? 1 : 0;
+    }
+  for (uint32_t port = 0, pick = live > 0 ? hash % live : 0; live > 0 && port < ports; port++)
+    {
+      if (IsPortUp (port) && pick-- == 0)
+        {
+          return port;
+        }
+    }
+  return -1;
+}
+
+bool
+ModFatTreeRouting::IsPortUp (uint32_t port) const
+{
+  // interface 0 is the loopback
+  uint32_t iface = port + 1;
+  return iface < m_ipv4->GetNInterfaces () && m_ipv4->IsUp (iface)
+         && m_ipv4->GetNetDevice (iface)->IsLinkUp ();
+}
+
+Ptr<Ipv4Route>
+ModFatTreeRouting::MakeRoute (uint32_t port, const Ipv4Header &header, Ipv4Address source) const
+{
+  NS_LOG_DEBUG (m_address << " port " << port << " to " << GetNeighbor (port) << " for " << header.GetDestination ());
+  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+  route->SetGateway (GetNeighbor (port));
+  route->SetSource (source);
+  route->SetDestination (header.GetDestination ());
+  route->SetOutputDevice (m_ipv4->GetNetDevice (port + 1));
+  return route;
+}
+
+void
+ModFatTreeRouting::NotifyInterfaceUp (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+}
+
+void
+ModFatTreeRouting::NotifyInterfaceDown (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+}
+
+// Every interface carries the node's address; the first one tells the
+// node where it sits in the tree.
+void
+ModFatTreeRouting::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+  NS_LOG_FUNCTION (this << interface << address);
+  if (interface != 1)
+    {
+      return;
+    }
+  m_address = address.GetLocal ();
+  uint32_t a = m_address.Get ();
+  uint32_t pod = (a >> 16) & 0xff, sw = (a >> 8) & 0xff, id = a & 0xff;
+  uint32_t half = m_k / 2;
+  if (pod == m_k)
+    {
+      m_role = CORE;
+      m_pod = sw - 1;
+      m_switch = id - 1;
+    }
+  else if (id == 1)
+    {
+      m_role = sw < half ? EDGE : AGGREGATION;
+      m_pod = pod;
+      m_switch = sw < half ? sw : sw - half;
+    }
+  else
+    {
+      m_role = HOST;
+      m_pod = pod;
+      m_switch = sw;
+    }
+}
+
+void
+ModFatTreeRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+  NS_LOG_FUNCTION (this << interface << address);
+}
+
+void
+ModFatTreeRouting::SetIpv4 (Ptr<Ipv4> ipv4)
+{
+  NS_LOG_FUNCTION (this << ipv4);
+  m_ipv4 = ipv4;
+}
+
+void
+ModFatTreeRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
+{
+  static const char *roles[] = { "host", "edge", "aggregation", "core" };
+  std::ostream &os = *stream->GetStream ();
+  os << "Node: " << m_ipv4->GetObject<Node> ()->GetId () << " " << roles[m_role] << " " << m_address
+     << " (k=" << m_k << ")" << std::endl;
+  uint32_t ports = m_role == HOST ? 1 : m_k;
+  for (uint32_t port = 0; port < ports; port++)
+    {
+      os << "  port " << port << " -> " << GetNeighbor (port) << (IsPortUp (port) ? "" : " (down)") << std::endl;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,96 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MOD_FAT_TREE_ROUTING_H
+#define MOD_FAT_TREE_ROUTING_H
+
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+
+// Table-free routing for a k-ary fat-tree built by ModFatTreeHelper.  The
+// tree has k pods of k/2 edge and k/2 aggregation switches, (k/2)^2 cores
+// and k/2 hosts per edge switch, addressed as
+//   host          10.pod.edge.(2 + h)
+//   edge switch   10.pod.edge.1
+//   aggregation   10.pod.(k/2 + a).1
+//   core          10.k.(1 + g).(1 + c)   (group g links to aggregation g)
+// and every node's port p is its interface p + 1: switches have their k/2
+// down ports first, then k/2 up ports; a core's port is the pod.  Each hop
+// follows from the destination address alone.  Going up, a flow hash over
+// addresses, protocol and ports picks one of the up ports whose link is up
+// (ECMP), so a flow keeps its path and flows spread over all of them.
+// Going down there is one way only; packets whose way down is cut are
+// dropped.
+class ModFatTreeRouting : public Ipv4RoutingProtocol
+{
+public:
+  enum Role
+  {
+    HOST,
+    EDGE,
+    AGGREGATION,
+    CORE
+  };
+
+  static TypeId GetTypeId (void);
+
+  ModFatTreeRouting ();
+  virtual ~ModFatTreeRouting ();
+
+  static Ipv4Address GetHostAddress (uint32_t pod, uint32_t edge, uint32_t host);
+  static Ipv4Address GetEdgeAddress (uint32_t pod, uint32_t edge);
+  static Ipv4Address GetAggregationAddress (uint32_t k, uint32_t pod, uint32_t agg);
+  static Ipv4Address GetCoreAddress (uint32_t k, uint32_t group, uint32_t core);
+
+  // Below are from Ipv4RoutingProtocol
+  virtual Ptr<Ipv4Route> RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif, Socket::SocketErrno &sockerr);
+  virtual bool RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                           UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                           LocalDeliverCallback lcb, ErrorCallback ecb);
+  virtual void NotifyInterfaceUp (uint32_t interface);
+  virtual void NotifyInterfaceDown (uint32_t interface);
+  virtual void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address);
+  virtual void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address);
+  virtual void SetIpv4 (Ptr<Ipv4> ipv4);
+  virtual void PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const;
+
+  Role GetRole (void) const;
+  // Port towards dst for a flow with the given hash, -1 if dst is not in
+  // the tree or every usable port is down.
+  int32_t GetPort (Ipv4Address dst, uint32_t hash) const;
+  // Address of the node at the other end of a port.
+  Ipv4Address GetNeighbor (uint32_t port) const;
+
+private:
+  uint32_t FlowHash (Ptr<const Packet> p, const Ipv4Header &header, bool l4) const;
+  int32_t UpPort (uint32_t hash) const;
+  int32_t DownPort (uint32_t hash) const;
+  bool IsPortUp (uint32_t port) const;
+  Ptr<Ipv4Route> MakeRoute (uint32_t port, const Ipv4Header &header, Ipv4Address source) const;
+
+  uint32_t m_k;
+  Ptr<Ipv4> m_ipv4;
+  Ipv4Address m_address;
+  Role m_role;
+  uint32_t m_pod;        // the core group for a core
+  uint32_t m_switch;     // edge, aggregation or core index in its pod or group
+};
+
+} // namespace ns3
+
+#endif /* MOD_FAT_TREE_ROUTING_H */
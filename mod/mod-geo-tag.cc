@@ -0,0 +1,91 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "mod-geo-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ModGeoTag);
+
+TypeId
+ModGeoTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ModGeoTag")
+    .SetParent<Tag> ()
+    .AddConstructor<ModGeoTag> ()
+    ;
+  return tid;
+}
+
+ModGeoTag::ModGeoTag ()
+{
+}
+
+TypeId
+ModGeoTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+ModGeoTag::GetSerializedSize (void) const
+{
+  return 1 + 4 * sizeof (double) + 3 * sizeof (uint32_t);
+}
+
+void
+ModGeoTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_state.perimeter ? 1 : 0);
+  i.WriteDouble (m_state.lp.x);
+  i.WriteDouble (m_state.lp.y);
+  i.WriteDouble (m_state.lf.x);
+  i.WriteDouble (m_state.lf.y);
+  i.WriteU32 (m_state.e0From);
+  i.WriteU32 (m_state.e0To);
+  i.WriteU32 (m_state.prev);
+}
+
+void
+ModGeoTag::Deserialize (TagBuffer i)
+{
+  m_state.perimeter = i.ReadU8 () != 0;
+  m_state.lp.x = i.ReadDouble ();
+  m_state.lp.y = i.ReadDouble ();
+  m_state.lf.x = i.ReadDouble ();
+  m_state.lf.y = i.ReadDouble ();
+  m_state.e0From = i.ReadU32 ();
+  m_state.e0To = i.ReadU32 ();
+  m_state.prev = i.ReadU32 ();
+}
+
+void
+ModGeoTag::Print (std::ostream &os) const
+{
+  os << (m_state.perimeter ? "perimeter" : "greedy");
+  if (m_state.perimeter)
+    {
+      os << " lp=(" << m_state.lp.x << "," << m_state.lp.y << ") e0=" << m_state.e0From << "-" << m_state.e0To;
+    }
+}
+
+ModGeoTag::State&
+ModGeoTag::GetState (void)
+{
+  return m_state;
+}
+
+}
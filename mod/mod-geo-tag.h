@@ -0,0 +1,49 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MOD_GEO_TAG_H
+#define MOD_GEO_TAG_H
+
+#include "ns3/tag.h"
+#include "mod-routing-core.h"
+
+namespace ns3 {
+
+// Greedy/perimeter state of a packet routed in the table's GEOGRAPHIC
+// mode.  Fixed size, so every hop can replace it in place.
+class ModGeoTag : public Tag
+{
+public:
+  typedef modcore::GeoState<uint32_t> State;
+
+  ModGeoTag ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  State& GetState (void);
+
+private:
+  State m_state;
+};
+
+}
+
+#endif /* MOD_GEO_TAG_H */
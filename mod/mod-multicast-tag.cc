@@ -0,0 +1,84 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "mod-multicast-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ModMulticastTag);
+
+TypeId
+ModMulticastTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ModMulticastTag")
+    .SetParent<Tag> ()
+    .AddConstructor<ModMulticastTag> ()
+    ;
+  return tid;
+}
+
+ModMulticastTag::ModMulticastTag ()
+{
+}
+
+ModMulticastTag::ModMulticastTag (Ipv4Address sender)
+  : m_sender (sender)
+{
+}
+
+TypeId
+ModMulticastTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+ModMulticastTag::GetSerializedSize (void) const
+{
+  return 4;
+}
+
+void
+ModMulticastTag::Serialize (TagBuffer i) const
+{
+  i.WriteU32 (m_sender.Get ());
+}
+
+void
+ModMulticastTag::Deserialize (TagBuffer i)
+{
+  m_sender.Set (i.ReadU32 ());
+}
+
+void
+ModMulticastTag::Print (std::ostream &os) const
+{
+  os << "sender=" << m_sender;
+}
+
+Ipv4Address
+ModMulticastTag::GetSender (void) const
+{
+  return m_sender;
+}
+
+void
+ModMulticastTag::SetSender (Ipv4Address sender)
+{
+  m_sender = sender;
+}
+
+}
@@ -0,0 +1,50 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MOD_MULTICAST_TAG_H
+#define MOD_MULTICAST_TAG_H
+
+#include "ns3/tag.h"
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+
+// Node that sent a multicast packet over its last hop.  A receiver keeps
+// the packet only if that node is its parent on the packet's tree, since on
+// a shared medium everyone in range hears every branch point.
+class ModMulticastTag : public Tag
+{
+public:
+  ModMulticastTag ();
+  explicit ModMulticastTag (Ipv4Address sender);
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  Ipv4Address GetSender (void) const;
+  void SetSender (Ipv4Address sender);
+
+private:
+  Ipv4Address m_sender;
+};
+
+}
+
+#endif /* MOD_MULTICAST_TAG_H */
@@ -0,0 +1,2979 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+// Route computation used by ModRoutingTable, kept free of any simulator
+// type so offline tools and micro-benchmarks can include it on its own.
+// Everything is templated on the node index type, the weight type and a
+// metric policy; unit-weight metrics get BFS-based engines at compile time.
+//
+// Path matrices are row-major n x n arrays owned by the caller:
+// pred[i * n + j] is the node before j on the path from i (i itself when
+// j == i or j is unreachable) and dist[i * n + j] the path length.
+
+#ifndef MOD_ROUTING_CORE_H
+#define MOD_ROUTING_CORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+namespace modcore {
+
+template <typename Weight>
+inline Weight
+Infinity (void)
+{
+  return std::numeric_limits<Weight>::has_infinity
+         ? std::numeric_limits<Weight>::infinity ()
+         : std::numeric_limits<Weight>::max ();
+}
+
+// Every in-range link costs one hop.
+struct HopCountMetric
+{
+  static const bool UNIT_WEIGHT = true;
+  template <typename Weight>
+  static Weight LinkWeight (double /* length */)
+  {
+    return 1;
+  }
+};
+
+// Links cost their length.
+struct EuclideanMetric
+{
+  static const bool UNIT_WEIGHT = false;
+  template <typename Weight>
+  static Weight LinkWeight (double length)
+  {
+    return static_cast<Weight> (length);
+  }
+};
+
+struct Point
+{
+  Point () : x (0), y (0), z (0) {}
+  Point (double px, double py, double pz) : x (px), y (py), z (pz) {}
+  double x, y, z;
+};
+
+inline double
+Distance (const Point &a, const Point &b)
+{
+  return std::sqrt ((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y)
+                    + (a.z - b.z) * (a.z - b.z));
+}
+
+// Undirected graph in CSR form; neighbor lists are sorted.
+template <typename Index, typename Weight>
+class Graph
+{
+public:
+  Graph () : m_offset (1, 0) {}
+
+  Index GetN (void) const
+  {
+    return m_offset.size () - 1;
+  }
+  // directed arcs, twice the number of links
+  size_t GetNArcs (void) const
+  {
+    return m_target.size ();
+  }
+  uint32_t Degree (Index u) const
+  {
+    return m_offset[u + 1] - m_offset[u];
+  }
+  const Index* Begin (Index u) const
+  {
+    return m_target.data () + m_offset[u];
+  }
+  const Index* End (Index u) const
+  {
+    return m_target.data () + m_offset[u + 1];
+  }
+  const Weight* Weights (Index u) const
+  {
+    return m_weight.data () + m_offset[u];
+  }
+  bool HasArc (Index u, Index v) const
+  {
+    return std::binary_search (Begin (u), End (u), v);
+  }
+  // heap bytes held by the arrays
+  size_t GetBytes (void) const
+  {
+    return m_offset.capacity () * sizeof (uint32_t) + m_target.capacity () * sizeof (Index)
+           + m_weight.capacity () * sizeof (Weight);
+  }
+
+private:
+  template <typename I, typename W, typename M> friend class AdjacencyBuilder;
+  std::vector<uint32_t> m_offset;
+  std::vector<Index> m_target;
+  std::vector<Weight> m_weight;
+};
+
+// Collects undirected links, either given explicitly or found from node
+// positions and a transmission range, and packs them into a Graph.
+template <typename Index, typename Weight, typename Metric>
+class AdjacencyBuilder
+{
+public:
+  explicit AdjacencyBuilder (Index n) : m_n (n) {}
+
+  void AddEdge (Index u, Index v, double length)
+  {
+    Arc a = { u, v, length };
+    Arc b = { v, u, length };
+    m_arcs.push_back (a);
+    m_arcs.push_back (b);
+  }
+
+  // Links between distinct, non co-located nodes at most range apart.
+  // Nodes are bucketed into cubes of side range, so only the 27
+  // surrounding cubes are searched for each node.
+  void AddPositions (const std::vector<Point> &pos, double range)
+  {
+    if (range <= 0 || pos.empty ())
+      {
+        return;
+      }
+    std::vector<std::pair<uint64_t, Index> > cells (pos.size ());
+    for (size_t i = 0; i < pos.size (); i++)
+      {
+        cells[i] = std::make_pair (CellKey (pos[i], range, 0, 0, 0), (Index) i);
+      }
+    std::sort (cells.begin (), cells.end ());
+    for (size_t i = 0; i < pos.size (); i++)
+      {
+        for (int dx = -1; dx <= 1; dx++)
+          for (int dy = -1; dy <= 1; dy++)
+            for (int dz = -1; dz <= 1; dz++)
+              {
+                uint64_t key = CellKey (pos[i], range, dx, dy, dz);
+                typename std::vector<std::pair<uint64_t, Index> >::const_iterator it =
+                  std::lower_bound (cells.begin (), cells.end (), std::make_pair (key, (Index) 0));
+                for (; it != cells.end () && it->first == key; ++it)
+                  {
+                    if (it->second <= i)
+                      {
+                        continue;
+                      }
+                    double d = Distance (pos[i], pos[it->second]);
+                    if (d > 0 && d <= range)
+                      {
+                        AddEdge (i, it->second, d);
+                      }
+                  }
+              }
+      }
+  }
+
+  // Links of node u, or the link u-v, are left out of the graph whatever
+  // was added; u keeps its index.
+  void Isolate (Index u)
+  {
+    m_isolated.push_back (u);
+  }
+  void RemoveEdge (Index u, Index v)
+  {
+    m_removed.push_back (std::make_pair (std::min (u, v), std::max (u, v)));
+  }
+
+  Graph<Index, Weight> Build (void)
+  {
+    Graph<Index, Weight> g;
+    std::sort (m_arcs.begin (), m_arcs.end (), ArcLess);
+    m_arcs.erase (std::unique (m_arcs.begin (), m_arcs.end (), ArcSame), m_arcs.end ());
+    if (!m_isolated.empty () || !m_removed.empty ())
+      {
+        std::sort (m_isolated.begin (), m_isolated.end ());
+        std::sort (m_removed.begin (), m_removed.end ());
+        size_t kept = 0;
+        for (size_t k = 0; k < m_arcs.size (); k++)
+          {
+            const Arc &a = m_arcs[k];
+            if (std::binary_search (m_isolated.begin (), m_isolated.end (), a.from)
+                || std::binary_search (m_isolated.begin (), m_isolated.end (), a.to)
+                || std::binary_search (m_removed.begin (), m_removed.end (),
+                                       std::make_pair (std::min (a.from, a.to), std::max (a.from, a.to))))
+              {
+                continue;
+              }
+            m_arcs[kept++] = a;
+          }
+        m_arcs.resize (kept);
+      }
+    g.m_offset.assign (m_n + 1, 0);
+    g.m_target.resize (m_arcs.size ());
+    g.m_weight.resize (m_arcs.size ());
+    for (size_t k = 0; k < m_arcs.size (); k++)
+      {
+        g.m_offset[m_arcs[k].from + 1]++;
+        g.m_target[k] = m_arcs[k].to;
+        g.m_weight[k] = Metric::template LinkWeight<Weight> (m_arcs[k].length);
+      }
+    for (Index u = 0; u < m_n; u++)
+      {
+        g.m_offset[u + 1] += g.m_offset[u];
+      }
+    return g;
+  }
+
+private:
+  struct Arc
+  {
+    Index from;
+    Index to;
+    double length;
+  };
+  static bool ArcLess (const Arc &a, const Arc &b)
+  {
+    return a.from != b.from ? a.from < b.from : a.to < b.to;
+  }
+  static bool ArcSame (const Arc &a, const Arc &b)
+  {
+    return a.from == b.from && a.to == b.to;
+  }
+  static uint64_t CellKey (const Point &p, double range, int dx, int dy, int dz)
+  {
+    // 21 bits per axis, offset so negative coordinates pack as well
+    const int64_t bias = 1 << 20;
+    uint64_t cx = (uint64_t) ((int64_t) std::floor (p.x / range) + dx + bias) & 0x1fffff;
+    uint64_t cy = (uint64_t) ((int64_t) std::floor (p.y / range) + dy + bias) & 0x1fffff;
+    uint64_t cz = (uint64_t) ((int64_t) std::floor (p.z / range) + dz + bias) & 0x1fffff;
+    return (cx << 42) | (cy << 21) | cz;
+  }
+
+  Index m_n;
+  std::vector<Arc> m_arcs;
+  std::vector<Index> m_isolated;
+  std::vector<std::pair<Index, Index> > m_removed;
+};
+
+// Shortest-path tree from one source into one row of the path matrices,
+// optionally ignoring the link cutU-cutV.  The general case is Dijkstra
+// with a binary heap.
+template <typename Index, typename Weight, typename Metric, bool Unit = Metric::UNIT_WEIGHT>
+struct SingleSource
+{
+  static void Run (const Graph<Index, Weight> &g, Index src, Index *pred, Weight *dist,
+                   Index cutU = std::numeric_limits<Index>::max (),
+                   Index cutV = std::numeric_limits<Index>::max ())
+  {
+    typedef std::pair<Weight, Index> Item;
+    Index n = g.GetN ();
+    std::fill (pred, pred + n, src);
+    std::fill (dist, dist + n, Infinity<Weight> ());
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item> > heap;
+    dist[src] = 0;
+    heap.push (Item (0, src));
+    while (!heap.empty ())
+      {
+        Item top = heap.top ();
+        heap.pop ();
+        Index u = top.second;
+        if (top.first > dist[u])
+          {
+            continue;
+          }
+        const Weight *w = g.Weights (u);
+        for (const Index *v = g.Begin (u); v != g.End (u); ++v, ++w)
+          {
+            if ((u == cutU && *v == cutV) || (u == cutV && *v == cutU))
+              {
+                continue;
+              }
+            Weight candidate = dist[u] + *w;
+            if (candidate < dist[*v])
+              {
+                dist[*v] = candidate;
+                pred[*v] = u;
+                heap.push (Item (candidate, *v));
+              }
+          }
+      }
+  }
+};
+
+// Unit weights: plain BFS.
+template <typename Index, typename Weight, typename Metric>
+struct SingleSource<Index, Weight, Metric, true>
+{
+  static void Run (const Graph<Index, Weight> &g, Index src, Index *pred, Weight *dist,
+                   Index cutU = std::numeric_limits<Index>::max (),
+                   Index cutV = std::numeric_limits<Index>::max ())
+  {
+    Index n = g.GetN ();
+    std::fill (pred, pred + n, src);
+    std::fill (dist, dist + n, Infinity<Weight> ());
+    std::vector<Index> queue;
+    queue.reserve (n);
+    dist[src] = 0;
+    queue.push_back (src);
+    for (size_t head = 0; head < queue.size (); head++)
+      {
+        Index u = queue[head];
+        for (const Index *v = g.Begin (u); v != g.End (u); ++v)
+          {
+            if ((u == cutU && *v == cutV) || (u == cutV && *v == cutU))
+              {
+                continue;
+              }
+            if (dist[*v] == Infinity<Weight> ())
+              {
+                dist[*v] = dist[u] + 1;
+                pred[*v] = u;
+                queue.push_back (*v);
+              }
+          }
+      }
+  }
+};
+
+// Floyd-Warshall over the whole matrix, the engine the table always used.
+template <typename Index, typename Weight, typename Metric>
+struct FloydWarshall
+{
+  static void Run (const Graph<Index, Weight> &g, Index *pred, Weight *dist)
+  {
+    size_t n = g.GetN ();
+    for (size_t i = 0; i < n; i++)
+      {
+        std::fill (dist + i * n, dist + (i + 1) * n, Infinity<Weight> ());
+        std::fill (pred + i * n, pred + (i + 1) * n, (Index) i);
+        dist[i * n + i] = 0;
+        const Weight *w = g.Weights (i);
+        for (const Index *v = g.Begin (i); v != g.End (i); ++v, ++w)
+          {
+            dist[i * n + *v] = *w;
+          }
+      }
+    for (size_t k = 0; k < n; k++)
+      {
+        for (size_t i = 0; i < n; i++)
+          {
+            Weight dik = dist[i * n + k];
+            if (dik == Infinity<Weight> ())
+              {
+                continue;
+              }
+            for (size_t j = 0; j < n; j++)
+              {
+                Weight dkj = dist[k * n + j];
+                if (dkj != Infinity<Weight> () && dik + dkj < dist[i * n + j])
+                  {
+                    dist[i * n + j] = dik + dkj;
+                    pred[i * n + j] = pred[k * n + j];
+                  }
+              }
+          }
+      }
+  }
+};
+
+// All pairs: Floyd-Warshall in general, one BFS per source for unit weights.
+template <typename Index, typename Weight, typename Metric, bool Unit = Metric::UNIT_WEIGHT>
+struct AllPairs
+{
+  static void Run (const Graph<Index, Weight> &g, Index *pred, Weight *dist)
+  {
+    FloydWarshall<Index, Weight, Metric>::Run (g, pred, dist);
+  }
+};
+
+template <typename Index, typename Weight, typename Metric>
+struct AllPairs<Index, Weight, Metric, true>
+{
+  static void Run (const Graph<Index, Weight> &g, Index *pred, Weight *dist)
+  {
+    size_t n = g.GetN ();
+    for (size_t i = 0; i < n; i++)
+      {
+        SingleSource<Index, Weight, Metric, true>::Run (g, i, pred + i * n, dist + i * n);
+      }
+  }
+};
+
+inline unsigned
+LowestBit (uint64_t x)
+{
+#if defined (__GNUC__)
+  return __builtin_ctzll (x);
+#else
+  unsigned b = 0;
+  while (!(x & 1))
+    {
+      x >>= 1;
+      b++;
+    }
+  return b;
+#endif
+}
+
+// Unit-weight all pairs by multi-source BFS (MS-BFS): 64 * WORDS sources
+// are searched together, one bit each, so a level costs one pass over the
+// arcs for the whole batch.  Each node pulls the frontier bits of its
+// neighbors; the first neighbor to bring a source's bit becomes that
+// source's pred, so paths are shortest but may break ties differently
+// from the per-source BFS.
+template <typename Index, typename Weight, unsigned WORDS = 4>
+struct MultiSourceBfs
+{
+  static const unsigned BATCH = 64 * WORDS;
+
+  static void Run (const Graph<Index, Weight> &g, Index *pred, Weight *dist)
+  {
+    size_t n = g.GetN ();
+    std::vector<uint64_t> seen (n * WORDS), frontier (n * WORDS), next (n * WORDS);
+    for (size_t first = 0; first < n; first += BATCH)
+      {
+        size_t count = std::min<size_t> (BATCH, n - first);
+        std::fill (seen.begin (), seen.end (), 0);
+        std::fill (frontier.begin (), frontier.end (), 0);
+        for (size_t s = 0; s < count; s++)
+          {
+            size_t src = first + s;
+            std::fill (pred + src * n, pred + (src + 1) * n, (Index) src);
+            std::fill (dist + src * n, dist + (src + 1) * n, Infinity<Weight> ());
+            dist[src * n + src] = 0;
+            seen[src * WORDS + s / 64] |= uint64_t (1) << (s % 64);
+            frontier[src * WORDS + s / 64] |= uint64_t (1) << (s % 64);
+          }
+        for (Weight level = 1; ; level++)
+          {
+            bool any = false;
+            for (size_t v = 0; v < n; v++)
+              {
+                uint64_t claimed[WORDS] = { 0 };
+                uint64_t *sv = &seen[v * WORDS];
+                for (const Index *u = g.Begin (v); u != g.End (v); ++u)
+                  {
+                    const uint64_t *fu = &frontier[*u * WORDS];
+                    for (unsigned w = 0; w < WORDS; w++)
+                      {
+                        uint64_t fresh = fu[w] & ~sv[w] & ~claimed[w];
+                        claimed[w] |= fresh;
+                        for (; fresh; fresh &= fresh - 1)
+                          {
+                            size_t src = first + w * 64 + LowestBit (fresh);
+                            pred[src * n + v] = *u;
+                            dist[src * n + v] = level;
+                          }
+                      }
+                  }
+                for (unsigned w = 0; w < WORDS; w++)
+                  {
+                    next[v * WORDS + w] = claimed[w];
+                    any |= claimed[w] != 0;
+                  }
+              }
+            if (!any)
+              {
+                break;
+              }
+            for (size_t k = 0; k < n * WORDS; k++)
+              {
+                seen[k] |= next[k];
+              }
+            frontier.swap (next);
+          }
+      }
+  }
+
+  // Rough cost model: a batch costs a pass over the arcs (WORDS words per
+  // arc) per level, where per-source BFS costs BATCH passes in total.  For
+  // a radio graph the levels go as the diameter, about sqrt (pi n / degree)
+  // for nodes spread uniformly; the threshold was measured on such graphs.
+  static bool IsFaster (size_t n, size_t arcs)
+  {
+    if (n < BATCH / 2 || arcs == 0)
+      {
+        return false;
+      }
+    double degree = (double) arcs / n;
+    double levels = std::sqrt (3.14159 * n / degree);
+    return levels < BATCH / 10.0;
+  }
+};
+
+// Connected components by union-find; labels are dense and numbered in
+// order of each component's lowest node.  Returns the number of components.
+template <typename Index, typename Weight>
+Index
+Components (const Graph<Index, Weight> &g, std::vector<Index> &label)
+{
+  Index n = g.GetN ();
+  std::vector<Index> parent (n);
+  for (Index i = 0; i < n; i++)
+    {
+      parent[i] = i;
+    }
+  for (Index u = 0; u < n; u++)
+    {
+      for (const Index *v = g.Begin (u); v != g.End (u); ++v)
+        {
+          if (*v < u)
+            {
+              continue;
+            }
+          Index ru = u, rv = *v;
+          while (parent[ru] != ru)
+            {
+              ru = parent[ru] = parent[parent[ru]];
+            }
+          while (parent[rv] != rv)
+            {
+              rv = parent[rv] = parent[parent[rv]];
+            }
+          if (ru != rv)
+            {
+              parent[std::max (ru, rv)] = std::min (ru, rv);
+            }
+        }
+    }
+  Index count = 0;
+  label.assign (n, 0);
+  for (Index i = 0; i < n; i++)
+    {
+      // roots are the lowest node of their set, so parents are labelled first
+      label[i] = (parent[i] == i) ? count++ : label[parent[i]];
+    }
+  return count;
+}
+
+// Uninitialized array of T on a 64-byte (cache line) boundary, kept across
+// Reserve calls as long as it is large enough.  With huge pages requested,
+// blocks of 2MB or more are 2MB-aligned and marked MADV_HUGEPAGE so the
+// kernel can back them with transparent huge pages.
+template <typename T>
+class MatrixBuffer
+{
+public:
+  static const size_t ALIGNMENT = 64;
+  static const size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+  MatrixBuffer () : m_data (0), m_capacity (0), m_bytes (0), m_hugePages (false) {}
+  ~MatrixBuffer ()
+  {
+    Release ();
+  }
+
+  // Room for count elements; returns false if the allocation failed.
+  bool Reserve (size_t count, bool hugePages)
+  {
+    if (count <= m_capacity && hugePages == m_hugePages)
+      {
+        return true;
+      }
+    Release ();
+    size_t bytes = count * sizeof (T);
+    size_t alignment = ALIGNMENT;
+    if (hugePages && bytes >= HUGE_PAGE)
+      {
+        alignment = HUGE_PAGE;
+        bytes = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+      }
+    void *p = 0;
+    if (bytes == 0 || posix_memalign (&p, alignment, bytes) != 0)
+      {
+        return bytes == 0;
+      }
+#ifdef MADV_HUGEPAGE
+    if (alignment == HUGE_PAGE)
+      {
+        madvise (p, bytes, MADV_HUGEPAGE);
+      }
+#endif
+    m_data = static_cast<T *> (p);
+    m_capacity = bytes / sizeof (T);
+    m_bytes = bytes;
+    m_hugePages = hugePages;
+    return true;
+  }
+  void Release (void)
+  {
+    free (m_data);
+    m_data = 0;
+    m_capacity = 0;
+    m_bytes = 0;
+    m_hugePages = false;
+  }
+  T* Get (void) const
+  {
+    return m_data;
+  }
+  size_t GetCapacity (void) const
+  {
+    return m_capacity;
+  }
+  size_t GetBytes (void) const
+  {
+    return m_bytes;
+  }
+
+private:
+  MatrixBuffer (const MatrixBuffer &);
+  MatrixBuffer &operator = (const MatrixBuffer &);
+
+  T *m_data;
+  size_t m_capacity;
+  size_t m_bytes;
+  bool m_hugePages;
+};
+
+// Read access to a pair of path matrices.
+template <typename Index, typename Weight>
+class NextHopStore
+{
+public:
+  NextHopStore (size_t n, const Index *pred, const Weight *dist)
+    : m_n (n), m_pred (pred), m_dist (dist)
+  {
+  }
+  bool IsValid (void) const
+  {
+    return m_pred != 0 && m_dist != 0;
+  }
+  size_t GetN (void) const
+  {
+    return m_n;
+  }
+  bool IsReachable (Index i, Index j) const
+  {
+    return m_dist[i * m_n + j] != Infinity<Weight> ();
+  }
+  Weight GetDistance (Index i, Index j) const
+  {
+    return m_dist[i * m_n + j];
+  }
+  Index GetPred (Index i, Index j) const
+  {
+    return m_pred[i * m_n + j];
+  }
+  // first node after i towards j; i itself if j == i or unreachable
+  Index GetFirstHop (Index i, Index j) const
+  {
+    if (i == j || !IsReachable (i, j))
+      {
+        return i;
+      }
+    while (m_pred[i * m_n + j] != i)
+      {
+        j = m_pred[i * m_n + j];
+      }
+    return j;
+  }
+  // nodes after i up to and including j; empty if unreachable
+  void GetPath (Index i, Index j, std::vector<Index> &path) const
+  {
+    path.clear ();
+    if (i == j || !IsReachable (i, j))
+      {
+        return;
+      }
+    for (; j != i; j = m_pred[i * m_n + j])
+      {
+        path.push_back (j);
+      }
+    std::reverse (path.begin (), path.end ());
+  }
+
+private:
+  size_t m_n;
+  const Index *m_pred;
+  const Weight *m_dist;
+};
+
+// All pairs over the nodes that can relay, with every leaf (a node whose
+// one link goes to a node with others) answered through the node it hangs
+// off: a host's row and column are its switch's plus one link.  No
+// shortest path passes through a leaf, so routes stay exact while the
+// matrices shrink from n^2 to m^2 entries for m non-leaf nodes, i.e. scale
+// with switches rather than hosts on rack topologies.
+template <typename Index, typename Weight>
+class LeafAggregation
+{
+public:
+  static const Index NONE;
+
+  template <typename Metric>
+  void Build (const Graph<Index, Weight> &g)
+  {
+    Index n = g.GetN ();
+    m_attach.resize (n);
+    m_attachWeight.assign (n, 0);
+    m_core.assign (n, NONE);
+    m_node.clear ();
+    for (Index v = 0; v < n; v++)
+      {
+        m_attach[v] = v;
+        if (g.Degree (v) == 1 && g.Degree (*g.Begin (v)) > 1)
+          {
+            m_attach[v] = *g.Begin (v);
+            m_attachWeight[v] = *g.Weights (v);
+          }
+        else
+          {
+            m_core[v] = m_node.size ();
+            m_node.push_back (v);
+          }
+      }
+
+    // leaves only have links to the core, which keep their index there
+    Index m = m_node.size ();
+    AdjacencyBuilder<Index, Weight, IdentityWeight> builder (m);
+    for (Index c = 0; c < m; c++)
+      {
+        Index u = m_node[c];
+        const Weight *w = g.Weights (u);
+        for (const Index *v = g.Begin (u); v != g.End (u); ++v, ++w)
+          {
+            if (m_core[*v] != NONE && c < m_core[*v])
+              {
+                builder.AddEdge (c, m_core[*v], *w);
+              }
+          }
+      }
+    m_graph = builder.Build ();
+    m_pred.resize ((size_t) m * m);
+    m_dist.resize ((size_t) m * m);
+    if (m == 0)
+      {
+        return;
+      }
+    if (Metric::UNIT_WEIGHT && MultiSourceBfs<Index, Weight>::IsFaster (m, m_graph.GetNArcs ()))
+      {
+        MultiSourceBfs<Index, Weight>::Run (m_graph, &m_pred[0], &m_dist[0]);
+      }
+    else
+      {
+        AllPairs<Index, Weight, Metric>::Run (m_graph, &m_pred[0], &m_dist[0]);
+      }
+  }
+
+  Weight GetDistance (Index i, Index j) const
+  {
+    if (i == j)
+      {
+        return 0;
+      }
+    Weight core = GetStore ().GetDistance (m_core[m_attach[i]], m_core[m_attach[j]]);
+    return core == Infinity<Weight> () ? core : m_attachWeight[i] + core + m_attachWeight[j];
+  }
+  // first node after i towards j; i itself if j == i or unreachable
+  Index GetFirstHop (Index i, Index j) const
+  {
+    if (i == j || GetDistance (i, j) == Infinity<Weight> ())
+      {
+        return i;
+      }
+    if (m_attach[i] != i)
+      {
+        return m_attach[i];
+      }
+    if (m_attach[j] == i)
+      {
+        return j;
+      }
+    return m_node[GetStore ().GetFirstHop (m_core[i], m_core[m_attach[j]])];
+  }
+  // nodes after i up to and including j; empty if unreachable
+  void GetPath (Index i, Index j, std::vector<Index> &path) const
+  {
+    path.clear ();
+    if (i == j || GetDistance (i, j) == Infinity<Weight> ())
+      {
+        return;
+      }
+    if (m_attach[i] != i)
+      {
+        path.push_back (m_attach[i]);
+      }
+    std::vector<Index> core;
+    GetStore ().GetPath (m_core[m_attach[i]], m_core[m_attach[j]], core);
+    for (size_t k = 0; k < core.size (); k++)
+      {
+        path.push_back (m_node[core[k]]);
+      }
+    if (m_attach[j] != j)
+      {
+        path.push_back (j);
+      }
+  }
+
+  // nodes with a row and column of their own
+  Index GetNCore (void) const
+  {
+    return m_node.size ();
+  }
+  size_t GetBytes (void) const
+  {
+    return m_pred.capacity () * sizeof (Index) + m_dist.capacity () * sizeof (Weight) + m_graph.GetBytes ()
+           + (m_attach.capacity () + m_core.capacity () + m_node.capacity ()) * sizeof (Index)
+           + m_attachWeight.capacity () * sizeof (Weight);
+  }
+
+private:
+  // the core graph takes the link weights as they are
+  struct IdentityWeight
+  {
+    static const bool UNIT_WEIGHT = false;
+    template <typename W>
+    static W LinkWeight (double length)
+    {
+      return length;
+    }
+  };
+
+  NextHopStore<Index, Weight> GetStore (void) const
+  {
+    return NextHopStore<Index, Weight> (m_node.size (), m_pred.empty () ? 0 : &m_pred[0],
+                                        m_dist.empty () ? 0 : &m_dist[0]);
+  }
+
+  std::vector<Index> m_attach;        // node each node hangs off, itself if in the core
+  std::vector<Weight> m_attachWeight; // length of that link, 0 in the core
+  std::vector<Index> m_core;          // core index of each node, NONE for leaves
+  std::vector<Index> m_node;          // node of each core index
+  Graph<Index, Weight> m_graph;
+  std::vector<Index> m_pred;          // m x m over core indices
+  std::vector<Weight> m_dist;
+};
+
+// Path matrices after each single link failure, kept as sparse diffs
+// against the intact matrices.  Only sources whose tree uses the link are
+// recomputed.  A link that is a bridge also moves the nodes on its far
+// side into a new partition, numbered after the existing ones.
+template <typename Index, typename Weight>
+class LinkFailureDiffs
+{
+public:
+  static const size_t NONE = (size_t) -1;
+
+  // One diff per link of g, spread over threads.
+  template <typename Metric>
+  void Build (const Graph<Index, Weight> &g, const Index *pred, const Weight *dist, unsigned threads)
+  {
+    Clear ();
+    size_t n = g.GetN ();
+    for (Index u = 0; u < n; u++)
+      {
+        for (const Index *v = g.Begin (u); v != g.End (u); ++v)
+          {
+            if (u < *v)
+              {
+                m_links.push_back (std::make_pair (u, *v));
+              }
+          }
+      }
+    std::vector<std::vector<Entry> > entries (m_links.size ());
+    std::vector<std::vector<Index> > split (m_links.size ());
+    threads = std::max (1u, std::min<unsigned> (threads, m_links.size ()));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++)
+      {
+        pool.push_back (std::thread (&LinkFailureDiffs::BuildRange<Metric>, this, std::cref (g), pred, dist,
+                                     t, threads, &entries, &split));
+      }
+    BuildRange<Metric> (g, pred, dist, 0, threads, &entries, &split);
+    for (size_t t = 0; t < pool.size (); t++)
+      {
+        pool[t].join ();
+      }
+
+    m_offset.push_back (0);
+    m_splitOffset.push_back (0);
+    for (size_t l = 0; l < m_links.size (); l++)
+      {
+        m_entries.insert (m_entries.end (), entries[l].begin (), entries[l].end ());
+        m_split.insert (m_split.end (), split[l].begin (), split[l].end ());
+        m_offset.push_back (m_entries.size ());
+        m_splitOffset.push_back (m_split.size ());
+        std::vector<Entry> ().swap (entries[l]);
+      }
+    m_applied.assign (m_links.size (), false);
+    m_splitLabel.assign (m_links.size (), 0);
+  }
+
+  void Clear (void)
+  {
+    m_links.clear ();
+    m_offset.clear ();
+    m_entries.clear ();
+    m_splitOffset.clear ();
+    m_split.clear ();
+    m_applied.clear ();
+    m_splitLabel.clear ();
+  }
+
+  size_t GetNLinks (void) const
+  {
+    return m_links.size ();
+  }
+  // diff of link u-v, NONE if there is no such link
+  size_t Find (Index u, Index v) const
+  {
+    std::pair<Index, Index> key (std::min (u, v), std::max (u, v));
+    typename std::vector<std::pair<Index, Index> >::const_iterator it =
+      std::lower_bound (m_links.begin (), m_links.end (), key);
+    return (it != m_links.end () && *it == key) ? it - m_links.begin () : NONE;
+  }
+  size_t GetNChanged (size_t link) const
+  {
+    return m_offset[link + 1] - m_offset[link] + m_splitOffset[link + 1] - m_splitOffset[link];
+  }
+  bool IsApplied (size_t link) const
+  {
+    return m_applied[link];
+  }
+
+  // Exchanges the diff with the matrices and partition labels, so the
+  // first call switches to the failed link and the second one back, each
+  // in O(changed entries).
+  void Swap (size_t link, Index *pred, Weight *dist, std::vector<Index> &label, Index &nComponents)
+  {
+    for (size_t k = m_offset[link]; k < m_offset[link + 1]; k++)
+      {
+        Entry &e = m_entries[k];
+        std::swap (pred[e.cell], e.pred);
+        std::swap (dist[e.cell], e.dist);
+      }
+    if (m_splitOffset[link] != m_splitOffset[link + 1])
+      {
+        Index to = m_applied[link] ? m_splitLabel[link] : nComponents;
+        if (!m_applied[link])
+          {
+            m_splitLabel[link] = label[m_split[m_splitOffset[link]]];
+          }
+        for (size_t k = m_splitOffset[link]; k < m_splitOffset[link + 1]; k++)
+          {
+            label[m_split[k]] = to;
+          }
+        nComponents += m_applied[link] ? -1 : 1;
+      }
+    m_applied[link] = !m_applied[link];
+  }
+
+  size_t GetBytes (void) const
+  {
+    return m_links.capacity () * sizeof (std::pair<Index, Index>)
+           + (m_offset.capacity () + m_splitOffset.capacity ()) * sizeof (size_t)
+           + m_entries.capacity () * sizeof (Entry) + m_split.capacity () * sizeof (Index)
+           + m_applied.capacity () / 8 + m_splitLabel.capacity () * sizeof (Index);
+  }
+
+private:
+  struct Entry
+  {
+    size_t cell;
+    Index pred;
+    Weight dist;
+  };
+
+  template <typename Metric>
+  void BuildRange (const Graph<Index, Weight> &g, const Index *pred, const Weight *dist,
+                   unsigned first, unsigned stride,
+                   std::vector<std::vector<Entry> > *entries, std::vector<std::vector<Index> > *split) const
+  {
+    size_t n = g.GetN ();
+    std::vector<Index> rowPred (n);
+    std::vector<Weight> rowDist (n);
+    for (size_t l = first; l < m_links.size (); l += stride)
+      {
+        Index u = m_links[l].first;
+        Index v = m_links[l].second;
+        std::vector<Entry> &out = (*entries)[l];
+        for (size_t s = 0; s < n; s++)
+          {
+            const Index *p = pred + s * n;
+            const Weight *d = dist + s * n;
+            if (p[v] != u && p[u] != v)
+              {
+                continue;
+              }
+            SingleSource<Index, Weight, Metric>::Run (g, s, &rowPred[0], &rowDist[0], u, v);
+            for (size_t j = 0; j < n; j++)
+              {
+                if (rowPred[j] != p[j] || rowDist[j] != d[j])
+                  {
+                    Entry e = { s * n + j, rowPred[j], rowDist[j] };
+                    out.push_back (e);
+                  }
+              }
+            if (s == u)
+              {
+                // nodes u can no longer reach are on the far side of a bridge
+                for (size_t j = 0; j < n; j++)
+                  {
+                    if (rowDist[j] == Infinity<Weight> () && d[j] != Infinity<Weight> ())
+                      {
+                        (*split)[l].push_back (j);
+                      }
+                  }
+              }
+          }
+      }
+  }
+
+  std::vector<std::pair<Index, Index> > m_links; // sorted
+  std::vector<size_t> m_offset;
+  std::vector<Entry> m_entries;
+  std::vector<size_t> m_splitOffset;
+  std::vector<Index> m_split;
+  std::vector<bool> m_applied;
+  std::vector<Index> m_splitLabel;
+};
+
+// Single-pair A* search.  The work arrays are kept between queries and
+// reset by a stamp, so a query only touches the nodes it settles.
+template <typename Index, typename Weight>
+class PairSearch
+{
+public:
+  PairSearch () : m_stamp (0) {}
+
+  // Shortest path from src to dst as the nodes after src, dst last;
+  // returns its length, Infinity if there is none.  bound (v) must be a
+  // consistent lower bound on the distance from v to dst.
+  template <typename Bound>
+  Weight Run (const Graph<Index, Weight> &g, Index src, Index dst, const Bound &bound,
+              std::vector<Index> &path)
+  {
+    typedef std::pair<Weight, Index> Item;
+    size_t n = g.GetN ();
+    path.clear ();
+    if (m_seen.size () != n)
+      {
+        m_seen.assign (n, 0);
+        m_dist.resize (n);
+        m_pred.resize (n);
+        m_stamp = 0;
+      }
+    if (++m_stamp == 0)
+      {
+        std::fill (m_seen.begin (), m_seen.end (), 0);
+        m_stamp = 1;
+      }
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item> > heap;
+    Touch (src);
+    m_dist[src] = 0;
+    heap.push (Item (bound (src), src));
+    while (!heap.empty ())
+      {
+        Item top = heap.top ();
+        heap.pop ();
+        Index u = top.second;
+        if (top.first > m_dist[u] + bound (u))
+          {
+            continue;
+          }
+        if (u == dst)
+          {
+            for (Index v = dst; v != src; v = m_pred[v])
+              {
+                path.push_back (v);
+              }
+            std::reverse (path.begin (), path.end ());
+            return m_dist[dst];
+          }
+        const Weight *w = g.Weights (u);
+        for (const Index *v = g.Begin (u); v != g.End (u); ++v, ++w)
+          {
+            Touch (*v);
+            Weight candidate = m_dist[u] + *w;
+            if (candidate < m_dist[*v])
+              {
+                m_dist[*v] = candidate;
+                m_pred[*v] = u;
+                heap.push (Item (candidate + bound (*v), *v));
+              }
+          }
+      }
+    return Infinity<Weight> ();
+  }
+
+private:
+  void Touch (Index v)
+  {
+    if (m_seen[v] != m_stamp)
+      {
+        m_seen[v] = m_stamp;
+        m_dist[v] = Infinity<Weight> ();
+      }
+  }
+
+  uint32_t m_stamp;
+  std::vector<uint32_t> m_seen;
+  std::vector<Weight> m_dist;
+  std::vector<Index> m_pred;
+};
+
+// Lower bounds on the rest of a path to target, for PairSearch: a hop
+// covers at most range, so ceil (d / range) hops remain; with Euclidean
+// weights the straight line.  Both are consistent.
+struct HopBound
+{
+  HopBound (const std::vector<Point> &pos, const Point &target, double range)
+    : m_pos (pos), m_target (target), m_range (range) {}
+  double operator() (size_t v) const
+  {
+    return std::max (0.0, std::ceil (Distance (m_pos[v], m_target) / m_range - 1e-9));
+  }
+  const std::vector<Point> &m_pos;
+  Point m_target;
+  double m_range;
+};
+
+struct LineBound
+{
+  LineBound (const std::vector<Point> &pos, const Point &target) : m_pos (pos), m_target (target) {}
+  double operator() (size_t v) const
+  {
+    return Distance (m_pos[v], m_target);
+  }
+  const std::vector<Point> &m_pos;
+  Point m_target;
+};
+
+struct NoBound
+{
+  double operator() (size_t) const
+  {
+    return 0;
+  }
+};
+
+// Groups nodes into balls of about size nodes by BFS from the lowest
+// unassigned node, for graphs without positions.
+template <typename Index, typename Weight>
+void
+GrowClusters (const Graph<Index, Weight> &g, size_t size, std::vector<uint32_t> &cell)
+{
+  Index n = g.GetN ();
+  const uint32_t none = std::numeric_limits<uint32_t>::max ();
+  cell.assign (n, none);
+  std::vector<Index> queue;
+  uint32_t next = 0;
+  for (Index s = 0; s < n; s++)
+    {
+      if (cell[s] != none)
+        {
+          continue;
+        }
+      queue.assign (1, s);
+      cell[s] = next;
+      for (size_t head = 0; head < queue.size () && queue.size () < size; head++)
+        {
+          for (const Index *v = g.Begin (queue[head]); v != g.End (queue[head]) && queue.size () < size; ++v)
+            {
+              if (cell[*v] == none)
+                {
+                  cell[*v] = next;
+                  queue.push_back (*v);
+                }
+            }
+        }
+      next++;
+    }
+}
+
+// Two-level routes for graphs too large for an n x n table.  Nodes are
+// grouped by a caller-chosen key (a grid cell, say); each connected piece
+// of a group is a cluster with its own all-pairs table, and clusters are
+// linked by a hop-count table over the cluster graph.  A packet heads for
+// the next cluster on the cluster path through the border link with the
+// shortest distance to its local end, plus the link, plus what is left
+// from its far end: the distance to the destination when that is the
+// destination's cluster, else to the nearest border link on into the
+// cluster after it.  Each hop shortens either the cluster distance or
+// that sum, so routes are loop-free but longer than shortest.  Pieces
+// under half the target size join a neighboring one, and the cluster table
+// is kept per connected part of the graph, so it stays about linear even
+// where sparse groups break up into many pieces.  With clusters of about
+// sqrt (n) nodes memory is about n sqrt (n).
+template <typename Index, typename Weight>
+class ClusterHierarchy
+{
+public:
+  // size is the target number of nodes per cluster
+  template <typename Metric>
+  void Build (const Graph<Index, Weight> &g, const std::vector<uint32_t> &key, size_t size)
+  {
+    Index n = g.GetN ();
+    // pieces of each group, by union-find over the links inside groups
+    std::vector<Index> parent (n);
+    for (Index u = 0; u < n; u++)
+      {
+        parent[u] = u;
+      }
+    for (Index u = 0; u < n; u++)
+      {
+        for (const Index *v = g.Begin (u); v != g.End (u); ++v)
+          {
+            if (key[*v] == key[u])
+              {
+                Index ru = Find (parent, u), rv = Find (parent, *v);
+                parent[std::max (ru, rv)] = std::min (ru, rv);
+              }
+          }
+      }
+    MergeSmall (g, std::max<size_t> (size / 2, 1), 2 * size, parent);
+
+    // clusters numbered by BFS, so those of each connected part (block) of
+    // the graph are consecutive
+    const Index none = std::numeric_limits<Index>::max ();
+    std::vector<Index> id (n, none);
+    std::vector<bool> seen (n, false);
+    std::vector<Index> queue;
+    Index nClusters = 0;
+    m_cluster.resize (n);
+    m_blockOf.clear ();
+    m_blockFirst.assign (1, 0);
+    for (Index s = 0; s < n; s++)
+      {
+        if (seen[s])
+          {
+            continue;
+          }
+        seen[s] = true;
+        queue.assign (1, s);
+        for (size_t head = 0; head < queue.size (); head++)
+          {
+            Index u = queue[head], r = Find (parent, u);
+            if (id[r] == none)
+              {
+                id[r] = nClusters++;
+                m_blockOf.push_back (m_blockFirst.size () - 1);
+              }
+            m_cluster[u] = id[r];
+            for (const Index *v = g.Begin (u); v != g.End (u); ++v)
+              {
+                if (!seen[*v])
+                  {
+                    seen[*v] = true;
+                    queue.push_back (*v);
+                  }
+              }
+          }
+        m_blockFirst.push_back (nClusters);
+      }
+
+    // members by cluster, and each node's index within its cluster
+    m_memberOffset.assign (nClusters + 1, 0);
+    for (Index u = 0; u < n; u++)
+      {
+        m_memberOffset[m_cluster[u] + 1]++;
+      }
+    for (Index c = 0; c < nClusters; c++)
+      {
+        m_memberOffset[c + 1] += m_memberOffset[c];
+      }
+    m_members.resize (n);
+    m_local.resize (n);
+    std::vector<uint32_t> fill (m_memberOffset.begin (), m_memberOffset.end () - 1);
+    for (Index u = 0; u < n; u++)
+      {
+        Index c = m_cluster[u];
+        m_local[u] = fill[c] - m_memberOffset[c];
+        m_members[fill[c]++] = u;
+      }
+
+    // one table per cluster
+    m_tableOffset.assign (nClusters + 1, 0);
+    for (Index c = 0; c < nClusters; c++)
+      {
+        size_t size = GetSize (c);
+        m_tableOffset[c + 1] = m_tableOffset[c] + size * size;
+      }
+    m_pred.resize (m_tableOffset[nClusters]);
+    m_dist.resize (m_tableOffset[nClusters]);
+    std::vector<std::pair<Index, Index> > border;
+    for (Index c = 0; c < nClusters; c++)
+      {
+        AdjacencyBuilder<Index, Weight, Metric> builder (GetSize (c));
+        for (uint32_t k = m_memberOffset[c]; k < m_memberOffset[c + 1]; k++)
+          {
+            Index u = m_members[k];
+            const Weight *w = g.Weights (u);
+            for (const Index *v = g.Begin (u); v != g.End (u); ++v, ++w)
+              {
+                if (m_cluster[*v] != c)
+                  {
+                    border.push_back (std::make_pair (u, *v));
+                  }
+                else if (u < *v)
+                  {
+                    builder.AddEdge (m_local[u], m_local[*v], *w);
+                  }
+              }
+          }
+        Graph<Index, Weight> local = builder.Build ();
+        if (GetSize (c) > 0)
+          {
+            AllPairs<Index, Weight, Metric>::Run (local, &m_pred[m_tableOffset[c]], &m_dist[m_tableOffset[c]]);
+          }
+      }
+
+    // cluster graph; the border links of each of its arcs, in arc order
+    std::sort (border.begin (), border.end (), BorderLess (m_cluster));
+    AdjacencyBuilder<Index, Weight, HopCountMetric> clusters (nClusters);
+    for (size_t k = 0; k < border.size (); k++)
+      {
+        clusters.AddEdge (m_cluster[border[k].first], m_cluster[border[k].second], 1);
+      }
+    m_clusterGraph = clusters.Build ();
+    m_border.swap (border);
+    m_borderWeight.resize (m_border.size ());
+    for (size_t k = 0; k < m_border.size (); k++)
+      {
+        Index u = m_border[k].first;
+        size_t pos = std::lower_bound (g.Begin (u), g.End (u), m_border[k].second) - g.Begin (u);
+        m_borderWeight[k] = g.Weights (u)[pos];
+      }
+    m_borderOffset.assign (m_clusterGraph.GetNArcs () + 1, 0);
+    for (size_t k = 0, arc = 0; k < m_border.size (); k++)
+      {
+        if (k > 0 && (m_cluster[m_border[k].first] != m_cluster[m_border[k - 1].first]
+                      || m_cluster[m_border[k].second] != m_cluster[m_border[k - 1].second]))
+          {
+            m_borderOffset[++arc] = k;
+          }
+      }
+    m_borderOffset[m_clusterGraph.GetNArcs ()] = m_border.size ();
+    // hop-count cluster paths, one table per block
+    size_t nBlocks = m_blockFirst.size () - 1;
+    m_blockOffset.assign (nBlocks + 1, 0);
+    for (size_t b = 0; b < nBlocks; b++)
+      {
+        size_t width = m_blockFirst[b + 1] - m_blockFirst[b];
+        m_blockOffset[b + 1] = m_blockOffset[b] + width * width;
+      }
+    m_clusterPred.resize (m_blockOffset[nBlocks]);
+    std::vector<Weight> dist;
+    for (size_t b = 0; b < nBlocks; b++)
+      {
+        Index first = m_blockFirst[b], width = m_blockFirst[b + 1] - first;
+        AdjacencyBuilder<Index, Weight, HopCountMetric> block (width);
+        for (Index c = first; c < first + width; c++)
+          {
+            for (const Index *d = m_clusterGraph.Begin (c); d != m_clusterGraph.End (c); ++d)
+              {
+                if (c < *d)
+                  {
+                    block.AddEdge (c - first, *d - first, 1);
+                  }
+              }
+          }
+        dist.resize ((size_t) width * width);
+        AllPairs<Index, Weight, HopCountMetric>::Run (block.Build (), &m_clusterPred[m_blockOffset[b]], &dist[0]);
+      }
+
+    // the way out of a cluster through each of its arcs, from each member
+    m_toBorderOffset.assign (m_clusterGraph.GetNArcs () + 1, 0);
+    size_t arc = 0;
+    for (Index c = 0; c < nClusters; c++)
+      {
+        for (const Index *d = m_clusterGraph.Begin (c); d != m_clusterGraph.End (c); ++d, ++arc)
+          {
+            m_toBorderOffset[arc + 1] = m_toBorderOffset[arc] + GetSize (c);
+          }
+      }
+    m_toBorder.assign (m_toBorderOffset.back (), Infinity<Weight> ());
+    for (arc = 0; arc + 1 < m_toBorderOffset.size (); arc++)
+      {
+        for (size_t k = m_borderOffset[arc]; k < m_borderOffset[arc + 1]; k++)
+          {
+            Index u = m_border[k].first, c = m_cluster[u];
+            for (uint32_t m = m_memberOffset[c]; m < m_memberOffset[c + 1]; m++)
+              {
+                Index v = m_members[m];
+                Weight &best = m_toBorder[m_toBorderOffset[arc] + m_local[v]];
+                best = std::min (best, LocalDistance (v, u) + m_borderWeight[k]);
+              }
+          }
+      }
+  }
+
+  Index GetNClusters (void) const
+  {
+    return m_clusterGraph.GetN ();
+  }
+  Index GetCluster (Index u) const
+  {
+    return m_cluster[u];
+  }
+  // i itself when j == i or j cannot be reached
+  Index GetNextHop (Index i, Index j) const
+  {
+    Index a = m_cluster[i], b = m_cluster[j];
+    if (i == j)
+      {
+        return i;
+      }
+    if (a == b)
+      {
+        return LocalFirstHop (i, j);
+      }
+    if (m_blockOf[a] != m_blockOf[b])
+      {
+        return i;
+      }
+    Index c = NextCluster (a, b);
+    size_t arc = GetArc (a, c);
+    size_t onward = (c == b) ? 0 : GetArc (c, NextCluster (c, b));
+    Index gateway = i, far = i;
+    Weight best = Infinity<Weight> ();
+    for (size_t k = m_borderOffset[arc]; k < m_borderOffset[arc + 1]; k++)
+      {
+        Index u = m_border[k].first, v = m_border[k].second;
+        Weight rest = (c == b) ? LocalDistance (v, j) : ToBorder (v, onward);
+        Weight d = LocalDistance (i, u) + m_borderWeight[k] + rest;
+        if (d < best)
+          {
+            best = d;
+            gateway = u;
+            far = v;
+          }
+      }
+    return gateway == i ? far : LocalFirstHop (i, gateway);
+  }
+  size_t GetBytes (void) const
+  {
+    return (m_cluster.capacity () + m_local.capacity () + m_members.capacity () + m_pred.capacity ()
+            + m_clusterPred.capacity () + m_blockOf.capacity () + m_blockFirst.capacity ()) * sizeof (Index)
+           + m_dist.capacity () * sizeof (Weight)
+           + m_memberOffset.capacity () * sizeof (uint32_t)
+           + (m_tableOffset.capacity () + m_borderOffset.capacity () + m_toBorderOffset.capacity ()
+              + m_blockOffset.capacity ()) * sizeof (size_t)
+           + m_border.capacity () * sizeof (std::pair<Index, Index>)
+           + (m_borderWeight.capacity () + m_toBorder.capacity ()) * sizeof (Weight)
+           + m_clusterGraph.GetBytes ();
+  }
+
+private:
+  struct BorderLess
+  {
+    explicit BorderLess (const std::vector<Index> &cluster) : m_c (cluster) {}
+    bool operator() (const std::pair<Index, Index> &x, const std::pair<Index, Index> &y) const
+    {
+      if (m_c[x.first] != m_c[y.first])
+        {
+          return m_c[x.first] < m_c[y.first];
+        }
+      if (m_c[x.second] != m_c[y.second])
+        {
+          return m_c[x.second] < m_c[y.second];
+        }
+      return x < y;
+    }
+    const std::vector<Index> &m_c;
+  };
+
+  // Joins each piece (union-find root) under minSize nodes to its smallest
+  // neighboring piece, in rounds while that keeps it within maxSize.
+  static void MergeSmall (const Graph<Index, Weight> &g, size_t minSize, size_t maxSize,
+                          std::vector<Index> &parent)
+  {
+    Index n = g.GetN ();
+    const Index none = std::numeric_limits<Index>::max ();
+    std::vector<size_t> size (n, 0);
+    for (Index u = 0; u < n; u++)
+      {
+        size[Find (parent, u)]++;
+      }
+    std::vector<Index> target (n, none);
+    bool merged = true;
+    while (merged)
+      {
+        merged = false;
+        for (Index u = 0; u < n; u++)
+          {
+            Index ru = Find (parent, u);
+            if (size[ru] >= minSize)
+              {
+                continue;
+              }
+            for (const Index *v = g.Begin (u); v != g.End (u); ++v)
+              {
+                Index rv = Find (parent, *v), t = target[ru];
+                if (rv != ru && (t == none || size[rv] < size[t] || (size[rv] == size[t] && rv < t)))
+                  {
+                    target[ru] = rv;
+                  }
+              }
+          }
+        for (Index r = 0; r < n; r++)
+          {
+            if (target[r] == none)
+              {
+                continue;
+              }
+            Index a = Find (parent, r), b = Find (parent, target[r]);
+            target[r] = none;
+            if (a != b && size[a] + size[b] <= maxSize)
+              {
+                parent[std::max (a, b)] = std::min (a, b);
+                size[std::min (a, b)] = size[a] + size[b];
+                merged = true;
+              }
+          }
+      }
+  }
+
+  // cluster after a on the cluster path to b, both in one block
+  Index NextCluster (Index a, Index b) const
+  {
+    Index block = m_blockOf[a], first = m_blockFirst[block];
+    const Index *pred = &m_clusterPred[m_blockOffset[block] + (size_t) (a - first) * (m_blockFirst[block + 1] - first)];
+    Index c = b - first;
+    while (pred[c] != a - first)
+      {
+        c = pred[c];
+      }
+    return c + first;
+  }
+  size_t GetArc (Index a, Index c) const
+  {
+    return std::lower_bound (m_clusterGraph.Begin (a), m_clusterGraph.End (a), c) - m_clusterGraph.Begin (0);
+  }
+  // from v out of its cluster through the nearest border link of arc
+  Weight ToBorder (Index v, size_t arc) const
+  {
+    return m_toBorder[m_toBorderOffset[arc] + m_local[v]];
+  }
+  static Index Find (std::vector<Index> &parent, Index u)
+  {
+    while (parent[u] != u)
+      {
+        u = parent[u] = parent[parent[u]];
+      }
+    return u;
+  }
+  size_t GetSize (Index c) const
+  {
+    return m_memberOffset[c + 1] - m_memberOffset[c];
+  }
+  Weight LocalDistance (Index i, Index j) const
+  {
+    Index c = m_cluster[i];
+    return m_dist[m_tableOffset[c] + m_local[i] * GetSize (c) + m_local[j]];
+  }
+  Index LocalFirstHop (Index i, Index j) const
+  {
+    Index c = m_cluster[i];
+    const Index *pred = &m_pred[m_tableOffset[c] + m_local[i] * GetSize (c)];
+    Index li = m_local[i], k = m_local[j];
+    while (pred[k] != li)
+      {
+        k = pred[k];
+      }
+    return m_members[m_memberOffset[c] + k];
+  }
+
+  std::vector<Index> m_cluster;        // cluster of each node
+  std::vector<Index> m_local;          // index within the cluster
+  std::vector<uint32_t> m_memberOffset;
+  std::vector<Index> m_members;
+  std::vector<size_t> m_tableOffset;   // each cluster's size x size table
+  std::vector<Index> m_pred;           // in local indices
+  std::vector<Weight> m_dist;
+  Graph<Index, Weight> m_clusterGraph;
+  std::vector<size_t> m_borderOffset;  // per cluster-graph arc
+  std::vector<std::pair<Index, Index> > m_border;
+  std::vector<Weight> m_borderWeight;
+  std::vector<size_t> m_toBorderOffset; // per cluster-graph arc
+  std::vector<Weight> m_toBorder;       // per arc, by local index
+  std::vector<Index> m_blockOf;          // block of each cluster
+  std::vector<Index> m_blockFirst;       // first cluster of each block
+  std::vector<size_t> m_blockOffset;     // each block's table
+  std::vector<Index> m_clusterPred;      // in clusters from the block's first
+};
+
+// Contraction hierarchy for exact weighted queries without n x n tables.
+// Nodes are contracted lowest priority (edge difference plus contracted
+// neighbors) first, adding a shortcut u-w past v unless a witness search
+// finds a path no longer than u-v-w; each round contracts an independent
+// set of local minima, spread over threads.  A node keeps its links to
+// nodes contracted after it as its upward graph, in CSR form; links are
+// undirected, so the downward graph is the same arrays read backwards.
+// A query is an upward search from each end meeting at the top of the
+// path, and shortcuts unpack through the node they skip.
+template <typename Index, typename Weight>
+class ContractionHierarchy
+{
+public:
+  static const Index NONE;
+
+  ContractionHierarchy () : m_nRecontracted (0) {}
+
+  // Contracts g with a fresh node order.
+  void Build (const Graph<Index, Weight> &g, unsigned threads)
+  {
+    Index n = g.GetN ();
+    m_base = g;
+    m_rank.assign (n, NONE);
+    m_order.clear ();
+    m_contracted.assign (n, false);
+    m_busy.assign (n, false);
+    m_work.assign (n, std::vector<Arc> ());
+    m_up.assign (n, std::vector<Arc> ());
+    for (Index u = 0; u < n; u++)
+      {
+        const Weight *w = g.Weights (u);
+        for (const Index *v = g.Begin (u); v != g.End (u); ++v, ++w)
+          {
+            m_work[u].push_back (Arc (*v, *w, NONE));
+          }
+      }
+    ContractByPriority (threads);
+    Pack ();
+    m_nRecontracted = n;
+  }
+
+  // Brings the hierarchy up to g keeping the node order.  Links only added
+  // or made cheaper leave every witness path below them intact, so only
+  // the nodes from the lowest changed end up are contracted again; a link
+  // lost or made dearer contracts everything again in the old order.
+  void Update (const Graph<Index, Weight> &g, unsigned threads)
+  {
+    Index n = g.GetN ();
+    if (n != m_base.GetN () || m_order.size () != n)
+      {
+        Build (g, threads);
+        return;
+      }
+    Index from = n;
+    for (Index u = 0; u < n && from > 0; u++)
+      {
+        const Index *a = m_base.Begin (u), *aEnd = m_base.End (u);
+        const Index *b = g.Begin (u), *bEnd = g.End (u);
+        const Weight *aw = m_base.Weights (u), *bw = g.Weights (u);
+        while ((a != aEnd || b != bEnd) && from > 0)
+          {
+            if (b == bEnd || (a != aEnd && *a < *b))
+              {
+                from = 0;
+              }
+            else if (a == aEnd || *b < *a)
+              {
+                from = std::min (from, std::min (m_rank[u], m_rank[*b]));
+                ++b, ++bw;
+              }
+            else
+              {
+                if (*bw > *aw)
+                  {
+                    from = 0;
+                  }
+                else if (*bw < *aw)
+                  {
+                    from = std::min (from, std::min (m_rank[u], m_rank[*b]));
+                  }
+                ++a, ++aw, ++b, ++bw;
+              }
+          }
+      }
+    m_base = g;
+    m_nRecontracted = n - from;
+    if (from == n)
+      {
+        return;
+      }
+
+    // the graph as it stood before contracting rank from: links between
+    // the nodes left plus the shortcuts past nodes ranked below
+    m_up.assign (n, std::vector<Arc> ());
+    m_work.assign (n, std::vector<Arc> ());
+    m_busy.assign (n, false);
+    for (Index u = 0; u < n; u++)
+      {
+        m_contracted[u] = m_rank[u] < from;
+        for (uint32_t k = m_upOffset[u]; k < m_upOffset[u + 1]; k++)
+          {
+            Arc arc (m_upTarget[k], m_upWeight[k], m_upVia[k]);
+            if (m_rank[u] < from)
+              {
+                m_up[u].push_back (arc);
+              }
+            else if (arc.via != NONE && m_rank[arc.via] < from)
+              {
+                AddLink (u, arc.to, arc.weight, arc.via);
+              }
+          }
+      }
+    for (Index u = 0; u < n; u++)
+      {
+        const Weight *w = g.Weights (u);
+        for (const Index *v = g.Begin (u); v != g.End (u); ++v, ++w)
+          {
+            if (u < *v && !m_contracted[u] && !m_contracted[*v])
+              {
+                AddLink (u, *v, *w, NONE);
+              }
+          }
+      }
+    ContractInOrder (from, threads);
+    Pack ();
+  }
+
+  // Length of the shortest u-v path, Infinity if there is none; hop gets
+  // the node after u on it (u itself when there is none).
+  Weight Query (Index u, Index v, Index *hop)
+  {
+    std::vector<Index> top;
+    Weight d = Search (u, v, top);
+    if (hop != 0)
+      {
+        *hop = top.size () < 2 ? u : FirstHop (top[0], top[1]);
+      }
+    return d;
+  }
+  // The nodes after u on the path, v last.
+  Weight GetPath (Index u, Index v, std::vector<Index> &path)
+  {
+    std::vector<Index> top;
+    Weight d = Search (u, v, top);
+    path.clear ();
+    for (size_t k = 1; k < top.size (); k++)
+      {
+        Unpack (top[k - 1], top[k], path);
+      }
+    return d;
+  }
+
+  Index GetN (void) const
+  {
+    return m_rank.size ();
+  }
+  // upward arcs, original links included
+  size_t GetNArcs (void) const
+  {
+    return m_upTarget.size ();
+  }
+  // nodes contracted by the last Build or Update
+  Index GetNRecontracted (void) const
+  {
+    return m_nRecontracted;
+  }
+  size_t GetBytes (void) const
+  {
+    return m_base.GetBytes () + (m_rank.capacity () + m_order.capacity () + m_upTarget.capacity ()
+                                 + m_upVia.capacity ()) * sizeof (Index)
+           + m_upOffset.capacity () * sizeof (uint32_t) + m_upWeight.capacity () * sizeof (Weight)
+           + m_side[0].GetBytes () + m_side[1].GetBytes ();
+  }
+
+private:
+  struct Arc
+  {
+    Arc (Index t, Weight w, Index v) : to (t), weight (w), via (v) {}
+    bool operator< (const Arc &o) const
+    {
+      return to < o.to;
+    }
+    Index to;
+    Weight weight;
+    Index via;       // the node a shortcut skips, NONE for a link
+  };
+  struct Shortcut
+  {
+    Index u, w;
+    Weight weight;
+  };
+
+  // Stamp-reset Dijkstra arrays, one per thread (witness searches) or
+  // per query side.
+  struct Space
+  {
+    Space () : stamp (0) {}
+    void Reset (size_t n)
+    {
+      if (seen.size () != n)
+        {
+          seen.assign (n, 0);
+          dist.resize (n);
+          pred.resize (n);
+          stamp = 0;
+        }
+      if (++stamp == 0)
+        {
+          std::fill (seen.begin (), seen.end (), 0);
+          stamp = 1;
+        }
+    }
+    bool Seen (Index v) const
+    {
+      return seen[v] == stamp;
+    }
+    void Touch (Index v)
+    {
+      if (seen[v] != stamp)
+        {
+          seen[v] = stamp;
+          dist[v] = Infinity<Weight> ();
+          pred[v] = NONE;
+        }
+    }
+    size_t GetBytes (void) const
+    {
+      return seen.capacity () * sizeof (uint32_t) + dist.capacity () * sizeof (Weight)
+             + pred.capacity () * sizeof (Index) + heap.capacity () * sizeof (std::pair<Weight, Index>);
+    }
+    uint32_t stamp;
+    std::vector<uint32_t> seen;
+    std::vector<Weight> dist;
+    std::vector<Index> pred;
+    std::vector<std::pair<Weight, Index> > heap;
+  };
+
+  // settled nodes per witness search, smaller when only counting
+  // shortcuts for a priority; past it a shortcut is kept, which costs
+  // space but never correctness
+  static const uint32_t WITNESS_LIMIT = 256;
+  static const uint32_t ESTIMATE_LIMIT = 2;
+
+  void AddArc (Index u, Index v, Weight w, Index via)
+  {
+    std::vector<Arc> &arcs = m_work[u];
+    for (size_t k = 0; k < arcs.size (); k++)
+      {
+        if (arcs[k].to == v)
+          {
+            if (w < arcs[k].weight)
+              {
+                arcs[k].weight = w;
+                arcs[k].via = via;
+              }
+            return;
+          }
+      }
+    arcs.push_back (Arc (v, w, via));
+  }
+  void AddLink (Index u, Index v, Weight w, Index via)
+  {
+    AddArc (u, v, w, via);
+    AddArc (v, u, w, via);
+  }
+
+  // Shortcuts contracting v would add.  Reads only; the nodes being
+  // contracted alongside v are left out of witness paths.
+  void FindShortcuts (Index v, uint32_t settleLimit, Space &space, std::vector<Shortcut> &out) const
+  {
+    typedef std::pair<Weight, Index> Item;
+    out.clear ();
+    const std::vector<Arc> &arcs = m_work[v];
+    std::vector<Item> &heap = space.heap;
+    for (size_t a = 0; a + 1 < arcs.size (); a++)
+      {
+        Index u = arcs[a].to;
+        space.Reset (m_work.size ());
+        Weight longest = 0;
+        for (size_t b = a + 1; b < arcs.size (); b++)
+          {
+            longest = std::max (longest, arcs[b].weight);
+            space.Touch (arcs[b].to);
+            space.pred[arcs[b].to] = v;
+          }
+        Weight limit = arcs[a].weight + longest;
+        size_t targets = arcs.size () - a - 1;
+        uint32_t settled = 0;
+        space.Touch (u);
+        space.dist[u] = 0;
+        heap.assign (1, Item (0, u));
+        while (!heap.empty () && settled < settleLimit && targets > 0)
+          {
+            std::pop_heap (heap.begin (), heap.end (), std::greater<Item> ());
+            Item top = heap.back ();
+            heap.pop_back ();
+            if (top.first > space.dist[top.second])
+              {
+                continue;
+              }
+            settled++;
+            if (space.pred[top.second] == v)
+              {
+                space.pred[top.second] = u;
+                targets--;
+              }
+            const std::vector<Arc> &next = m_work[top.second];
+            for (size_t k = 0; k < next.size (); k++)
+              {
+                Index x = next[k].to;
+                if (x == v || m_busy[x])
+                  {
+                    continue;
+                  }
+                space.Touch (x);
+                Weight candidate = top.first + next[k].weight;
+                if (candidate <= limit && candidate < space.dist[x])
+                  {
+                    space.dist[x] = candidate;
+                    heap.push_back (Item (candidate, x));
+                    std::push_heap (heap.begin (), heap.end (), std::greater<Item> ());
+                  }
+              }
+          }
+        for (size_t b = a + 1; b < arcs.size (); b++)
+          {
+            Weight through = arcs[a].weight + arcs[b].weight;
+            if (space.dist[arcs[b].to] > through)
+              {
+                Shortcut s = { u, arcs[b].to, through };
+                out.push_back (s);
+              }
+          }
+      }
+  }
+
+  // Contracts the marked independent set: shortcuts in parallel, then
+  // each node's arcs become its upward graph and leave its neighbors.
+  void ContractSet (const std::vector<Index> &set, unsigned threads, std::vector<Index> *touched)
+  {
+    std::vector<std::vector<Shortcut> > shortcuts (set.size ());
+    ForEach (set, WITNESS_LIMIT, threads, &shortcuts);
+    for (size_t k = 0; k < set.size (); k++)
+      {
+        Index v = set[k];
+        m_contracted[v] = true;
+        m_busy[v] = false;
+        m_up[v].swap (m_work[v]);
+        std::vector<Arc> ().swap (m_work[v]);
+        for (size_t a = 0; a < m_up[v].size (); a++)
+          {
+            Index u = m_up[v][a].to;
+            std::vector<Arc> &arcs = m_work[u];
+            for (size_t b = 0; b < arcs.size (); b++)
+              {
+                if (arcs[b].to == v)
+                  {
+                    arcs[b] = arcs.back ();
+                    arcs.pop_back ();
+                    break;
+                  }
+              }
+            if (touched != 0)
+              {
+                touched->push_back (u);
+              }
+          }
+        for (size_t s = 0; s < shortcuts[k].size (); s++)
+          {
+            AddLink (shortcuts[k][s].u, shortcuts[k][s].w, shortcuts[k][s].weight, v);
+          }
+      }
+  }
+
+  void ForEach (const std::vector<Index> &set, uint32_t settleLimit, unsigned threads,
+                std::vector<std::vector<Shortcut> > *out)
+  {
+    threads = std::max (1u, std::min<unsigned> (threads, set.size () / 16));
+    if (m_spaces.size () < threads)
+      {
+        m_spaces.resize (threads);
+      }
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++)
+      {
+        pool.push_back (std::thread (&ContractionHierarchy::FindRange, this, std::cref (set), settleLimit, t, threads,
+                                     out));
+      }
+    FindRange (set, settleLimit, 0, threads, out);
+    for (size_t t = 0; t < pool.size (); t++)
+      {
+        pool[t].join ();
+      }
+  }
+  void FindRange (const std::vector<Index> &set, uint32_t settleLimit, unsigned t, unsigned threads,
+                  std::vector<std::vector<Shortcut> > *out)
+  {
+    for (size_t k = t; k < set.size (); k += threads)
+      {
+        FindShortcuts (set[k], settleLimit, m_spaces[t], (*out)[k]);
+      }
+  }
+
+  void ContractByPriority (unsigned threads)
+  {
+    Index n = m_work.size ();
+    std::vector<int64_t> priority (n, 0);
+    std::vector<uint32_t> gone (n, 0);
+    std::vector<Index> all;
+    for (Index v = 0; v < n; v++)
+      {
+        all.push_back (v);
+      }
+    UpdatePriorities (all, gone, threads, priority);
+    std::vector<Index> left (all), set, touched;
+    while (!left.empty ())
+      {
+        // local minima of (priority, index) among the neighbors left
+        set.clear ();
+        for (size_t k = 0; k < left.size (); k++)
+          {
+            Index v = left[k];
+            bool minimum = true;
+            for (size_t a = 0; a < m_work[v].size () && minimum; a++)
+              {
+                Index u = m_work[v][a].to;
+                minimum = std::make_pair (priority[v], v) < std::make_pair (priority[u], u);
+              }
+            if (minimum)
+              {
+                set.push_back (v);
+                m_busy[v] = true;
+                m_rank[v] = m_order.size ();
+                m_order.push_back (v);
+              }
+          }
+        touched.clear ();
+        ContractSet (set, threads, &touched);
+        size_t kept = 0;
+        for (size_t k = 0; k < left.size (); k++)
+          {
+            if (!m_contracted[left[k]])
+              {
+                left[kept++] = left[k];
+              }
+          }
+        left.resize (kept);
+        std::sort (touched.begin (), touched.end ());
+        for (size_t k = 0; k < touched.size (); k++)
+          {
+            gone[touched[k]]++;
+          }
+        touched.erase (std::unique (touched.begin (), touched.end ()), touched.end ());
+        UpdatePriorities (touched, gone, threads, priority);
+      }
+  }
+  void UpdatePriorities (const std::vector<Index> &nodes, const std::vector<uint32_t> &gone,
+                         unsigned threads, std::vector<int64_t> &priority)
+  {
+    std::vector<std::vector<Shortcut> > shortcuts (nodes.size ());
+    ForEach (nodes, ESTIMATE_LIMIT, threads, &shortcuts);
+    for (size_t k = 0; k < nodes.size (); k++)
+      {
+        Index v = nodes[k];
+        priority[v] = (int64_t) shortcuts[k].size () - (int64_t) m_work[v].size () + gone[v];
+      }
+  }
+
+  // Contracts m_order[from..] in order, grouping runs of nodes with no
+  // links between them.
+  void ContractInOrder (Index from, unsigned threads)
+  {
+    Index n = m_work.size ();
+    std::vector<Index> set;
+    std::vector<bool> near (n, false);
+    for (Index r = from; r < n; )
+      {
+        set.clear ();
+        while (r < n && !near[m_order[r]] && set.size () < 1024)
+          {
+            Index v = m_order[r++];
+            set.push_back (v);
+            m_busy[v] = true;
+            for (size_t a = 0; a < m_work[v].size (); a++)
+              {
+                near[m_work[v][a].to] = true;
+              }
+          }
+        for (size_t k = 0; k < set.size (); k++)
+          {
+            for (size_t a = 0; a < m_work[set[k]].size (); a++)
+              {
+                near[m_work[set[k]][a].to] = false;
+              }
+          }
+        ContractSet (set, threads, 0);
+      }
+  }
+
+  void Pack (void)
+  {
+    Index n = m_up.size ();
+    m_upOffset.assign (1, 0);
+    m_upTarget.clear ();
+    m_upWeight.clear ();
+    m_upVia.clear ();
+    for (Index u = 0; u < n; u++)
+      {
+        std::sort (m_up[u].begin (), m_up[u].end ());
+        for (size_t k = 0; k < m_up[u].size (); k++)
+          {
+            m_upTarget.push_back (m_up[u][k].to);
+            m_upWeight.push_back (m_up[u][k].weight);
+            m_upVia.push_back (m_up[u][k].via);
+          }
+        m_upOffset.push_back (m_upTarget.size ());
+      }
+    std::vector<std::vector<Arc> > ().swap (m_up);
+    std::vector<std::vector<Arc> > ().swap (m_work);
+    std::vector<Space> ().swap (m_spaces);
+  }
+
+  // Upward searches from both ends; top gets the path's nodes in the
+  // hierarchy, u first.
+  Weight Search (Index u, Index v, std::vector<Index> &top)
+  {
+    typedef std::pair<Weight, Index> Item;
+    top.clear ();
+    Index n = m_rank.size ();
+    if (u == v)
+      {
+        top.push_back (u);
+        return 0;
+      }
+    Weight best = Infinity<Weight> ();
+    Index meet = NONE;
+    Index ends[2] = { u, v };
+    for (int s = 0; s < 2; s++)
+      {
+        Space &space = m_side[s];
+        std::vector<Item> &heap = space.heap;
+        space.Reset (n);
+        space.Touch (ends[s]);
+        space.dist[ends[s]] = 0;
+        space.pred[ends[s]] = ends[s];
+        heap.assign (1, Item (0, ends[s]));
+        while (!heap.empty ())
+          {
+            std::pop_heap (heap.begin (), heap.end (), std::greater<Item> ());
+            Item item = heap.back ();
+            heap.pop_back ();
+            Index x = item.second;
+            if (item.first > space.dist[x])
+              {
+                continue;
+              }
+            if (item.first >= best)
+              {
+                break;
+              }
+            if (s == 1 && m_side[0].Seen (x) && m_side[0].dist[x] + item.first < best)
+              {
+                best = m_side[0].dist[x] + item.first;
+                meet = x;
+              }
+            // stall on demand: a higher node already reached reaches x
+            // shorter, so nothing above x is reached best through it
+            bool stalled = false;
+            for (uint32_t k = m_upOffset[x]; k < m_upOffset[x + 1] && !stalled; k++)
+              {
+                Index y = m_upTarget[k];
+                stalled = space.Seen (y) && space.dist[y] + m_upWeight[k] < item.first;
+              }
+            for (uint32_t k = m_upOffset[x]; k < m_upOffset[x + 1] && !stalled; k++)
+              {
+                Index y = m_upTarget[k];
+                space.Touch (y);
+                Weight candidate = item.first + m_upWeight[k];
+                if (candidate < space.dist[y])
+                  {
+                    space.dist[y] = candidate;
+                    space.pred[y] = x;
+                    heap.push_back (Item (candidate, y));
+                    std::push_heap (heap.begin (), heap.end (), std::greater<Item> ());
+                  }
+              }
+          }
+      }
+    if (meet == NONE)
+      {
+        return best;
+      }
+    for (Index x = meet; x != u; x = m_side[0].pred[x])
+      {
+        top.push_back (x);
+      }
+    top.push_back (u);
+    std::reverse (top.begin (), top.end ());
+    for (Index x = meet; x != v; )
+      {
+        x = m_side[1].pred[x];
+        top.push_back (x);
+      }
+    return best;
+  }
+
+  // The node a u-v arc skips, NONE for a link.
+  Index Via (Index u, Index v) const
+  {
+    if (m_rank[v] < m_rank[u])
+      {
+        std::swap (u, v);
+      }
+    const Index *begin = &m_upTarget[0] + m_upOffset[u];
+    const Index *it = std::lower_bound (begin, &m_upTarget[0] + m_upOffset[u + 1], v);
+    return m_upVia[it - &m_upTarget[0]];
+  }
+  Index FirstHop (Index u, Index v) const
+  {
+    for (Index via = Via (u, v); via != NONE; via = Via (u, v))
+      {
+        v = via;
+      }
+    return v;
+  }
+  void Unpack (Index u, Index v, std::vector<Index> &path) const
+  {
+    Index via = Via (u, v);
+    if (via == NONE)
+      {
+        path.push_back (v);
+        return;
+      }
+    Unpack (u, via, path);
+    Unpack (via, v, path);
+  }
+
+  Graph<Index, Weight> m_base;         // the links contracted
+  std::vector<Index> m_rank;
+  std::vector<Index> m_order;
+  std::vector<uint32_t> m_upOffset;    // upward graph
+  std::vector<Index> m_upTarget;
+  std::vector<Weight> m_upWeight;
+  std::vector<Index> m_upVia;
+  Index m_nRecontracted;
+
+  // contraction only
+  std::vector<std::vector<Arc> > m_work;
+  std::vector<std::vector<Arc> > m_up;
+  std::vector<bool> m_contracted;
+  std::vector<bool> m_busy;
+  std::vector<Space> m_spaces;
+
+  Space m_side[2];                     // query searches
+};
+
+// Per-packet state of greedy-perimeter forwarding (GPSR), in the plane.
+template <typename Index>
+struct GeoState
+{
+  GeoState () : perimeter (false), e0From (0), e0To (0), prev (0) {}
+  bool perimeter;
+  Point lp;     // where the packet entered perimeter mode
+  Point lf;     // where it entered the current face
+  Index e0From; // first edge taken on the current face
+  Index e0To;
+  Index prev;   // node it came from
+};
+
+// Greedy forwarding to the neighbor nearest the destination; at a local
+// minimum the packet walks the faces of the Gabriel subgraph of the
+// neighbors by the right-hand rule, crossing to the next face where an edge
+// cuts the line from lp to the destination, and returns to greedy once it
+// is nearer than lp.  Only x and y are used.
+template <typename Index>
+class GreedyPerimeter
+{
+public:
+  typedef std::pair<Index, Point> Neighbor;
+
+  // nbrs are the usable neighbors of self, at their current positions.
+  // Returns self when there is no next hop: no neighbors, or the packet went
+  // round a whole face, so the destination cannot be reached.
+  static Index NextHop (Index self, const Point &at, Index dst, const Point &to,
+                        const std::vector<Neighbor> &nbrs, GeoState<Index> &state)
+  {
+    for (size_t k = 0; k < nbrs.size (); k++)
+      {
+        if (nbrs[k].first == dst)
+          {
+            state.prev = self;
+            return dst;
+          }
+      }
+    bool entering = false;
+    if (state.perimeter && Distance2D (at, to) < Distance2D (state.lp, to))
+      {
+        state.perimeter = false;
+      }
+    if (!state.perimeter)
+      {
+        Index best = self;
+        double bestDist = Distance2D (at, to);
+        for (size_t k = 0; k < nbrs.size (); k++)
+          {
+            double d = Distance2D (nbrs[k].second, to);
+            if (d < bestDist)
+              {
+                bestDist = d;
+                best = nbrs[k].first;
+              }
+          }
+        if (best != self)
+          {
+            state.prev = self;
+            return best;
+          }
+        state.perimeter = true;
+        state.lp = state.lf = at;
+        entering = true;
+      }
+
+    std::vector<Neighbor> planar;
+    Planarize (at, nbrs, planar);
+    Index next;
+    if (entering)
+      {
+        // entering perimeter mode: first edge counterclockwise from the
+        // direction of the destination
+        next = RightHand (self, at, to, planar, self);
+        if (next == self)
+          {
+            return self;
+          }
+        state.e0From = self;
+        state.e0To = next;
+      }
+    else
+      {
+        const Point *from = Find (planar, state.prev);
+        if (from == 0)
+          {
+            from = Find (nbrs, state.prev);
+          }
+        next = RightHand (self, at, from != 0 ? *from : to, planar, state.prev);
+        if (next == self || (self == state.e0From && next == state.e0To))
+          {
+            return self;
+          }
+      }
+    next = FaceChange (self, at, to, planar, next, state);
+    state.prev = self;
+    return next;
+  }
+
+private:
+  static double Distance2D (const Point &a, const Point &b)
+  {
+    return std::sqrt ((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+  }
+  static const Point* Find (const std::vector<Neighbor> &nbrs, Index v)
+  {
+    for (size_t k = 0; k < nbrs.size (); k++)
+      {
+        if (nbrs[k].first == v)
+          {
+            return &nbrs[k].second;
+          }
+      }
+    return 0;
+  }
+  // Gabriel graph: keep u-v unless another neighbor lies strictly inside
+  // the circle with diameter u-v
+  static void Planarize (const Point &at, const std::vector<Neighbor> &nbrs, std::vector<Neighbor> &planar)
+  {
+    for (size_t k = 0; k < nbrs.size (); k++)
+      {
+        const Point &v = nbrs[k].second;
+        Point mid ((at.x + v.x) / 2, (at.y + v.y) / 2, 0);
+        double radius = Distance2D (at, v) / 2;
+        bool keep = true;
+        for (size_t w = 0; w < nbrs.size () && keep; w++)
+          {
+            keep = w == k || Distance2D (nbrs[w].second, mid) >= radius;
+          }
+        if (keep)
+          {
+            planar.push_back (nbrs[k]);
+          }
+      }
+  }
+  // first neighbor counterclockwise from the direction of ref, other than
+  // skip unless it is the only one
+  static Index RightHand (Index self, const Point &at, const Point &ref,
+                          const std::vector<Neighbor> &planar, Index skip)
+  {
+    const double pi = 3.14159265358979323846;
+    double in = std::atan2 (ref.y - at.y, ref.x - at.x);
+    Index best = self;
+    double bestAngle = 3 * pi;
+    for (size_t k = 0; k < planar.size (); k++)
+      {
+        if (planar[k].first == skip)
+          {
+            continue;
+          }
+        double angle = std::atan2 (planar[k].second.y - at.y, planar[k].second.x - at.x) - in;
+        if (angle <= 0)
+          {
+            angle += 2 * pi;
+          }
+        if (angle < bestAngle)
+          {
+            bestAngle = angle;
+            best = planar[k].first;
+          }
+      }
+    return (best == self && Find (planar, skip) != 0) ? skip : best;
+  }
+  // while the edge to next cuts lp-destination nearer the destination than
+  // lf, move onto the next face
+  static Index FaceChange (Index self, const Point &at, const Point &to,
+                           const std::vector<Neighbor> &planar, Index next, GeoState<Index> &state)
+  {
+    for (size_t guard = 0; guard < planar.size (); guard++)
+      {
+        const Point *pn = Find (planar, next);
+        Point cut;
+        if (pn == 0 || !Intersect (at, *pn, state.lp, to, cut)
+            || Distance2D (cut, to) >= Distance2D (state.lf, to))
+          {
+            break;
+          }
+        state.lf = cut;
+        next = RightHand (self, at, *pn, planar, next);
+        state.e0From = self;
+        state.e0To = next;
+      }
+    return next;
+  }
+  static bool Intersect (const Point &a, const Point &b, const Point &c, const Point &d, Point &cut)
+  {
+    double rx = b.x - a.x, ry = b.y - a.y, sx = d.x - c.x, sy = d.y - c.y;
+    double den = rx * sy - ry * sx;
+    if (den == 0)
+      {
+        return false;
+      }
+    double t = ((c.x - a.x) * sy - (c.y - a.y) * sx) / den;
+    double u = ((c.x - a.x) * ry - (c.y - a.y) * rx) / den;
+    if (t < 0 || t > 1 || u < 0 || u > 1)
+      {
+        return false;
+      }
+    cut = Point (a.x + t * rx, a.y + t * ry, 0);
+    return true;
+  }
+};
+
+// Piecewise-linear path of one node: the position at each waypoint time,
+// interpolated in between and held before the first and after the last.
+class Trajectory
+{
+public:
+  // waypoints must come in time order
+  void Add (double t, const Point &p)
+  {
+    m_time.push_back (t);
+    m_pos.push_back (p);
+  }
+  // ns-2 setdest: from wherever the node is at t, head for dest at speed;
+  // the rest of the previous leg is dropped
+  void MoveTo (double t, const Point &dest, double speed)
+  {
+    Point from = GetPosition (t);
+    size_t keep = std::upper_bound (m_time.begin (), m_time.end (), t) - m_time.begin ();
+    m_time.resize (keep);
+    m_pos.resize (keep);
+    Add (t, from);
+    if (speed > 0)
+      {
+        Add (t + Distance (from, dest) / speed, dest);
+      }
+  }
+  Point GetPosition (double t) const
+  {
+    if (m_time.empty ())
+      {
+        return Point ();
+      }
+    size_t k = std::upper_bound (m_time.begin (), m_time.end (), t) - m_time.begin ();
+    if (k == 0)
+      {
+        return m_pos.front ();
+      }
+    if (k == m_time.size ())
+      {
+        return m_pos.back ();
+      }
+    const Point &a = m_pos[k - 1];
+    const Point &b = m_pos[k];
+    double f = (t - m_time[k - 1]) / (m_time[k] - m_time[k - 1]);
+    return Point (a.x + (b.x - a.x) * f, a.y + (b.y - a.y) * f, a.z + (b.z - a.z) * f);
+  }
+  const std::vector<double>& GetTimes (void) const
+  {
+    return m_time;
+  }
+
+private:
+  std::vector<double> m_time;
+  std::vector<Point> m_pos;
+};
+
+// Times in (t0, t1] at which nodes a and b come exactly range apart.  Both
+// move linearly between their merged waypoint times, so each such segment
+// is a quadratic in t.
+inline void
+RangeCrossings (const Trajectory &a, const Trajectory &b, double range, double t0, double t1,
+                std::vector<double> &out)
+{
+  std::vector<double> cuts (1, t0);
+  for (size_t k = 0; k < a.GetTimes ().size (); k++)
+    {
+      cuts.push_back (a.GetTimes ()[k]);
+    }
+  for (size_t k = 0; k < b.GetTimes ().size (); k++)
+    {
+      cuts.push_back (b.GetTimes ()[k]);
+    }
+  cuts.push_back (t1);
+  std::sort (cuts.begin (), cuts.end ());
+  for (size_t k = 0; k + 1 < cuts.size (); k++)
+    {
+      double s = std::max (cuts[k], t0);
+      double e = std::min (cuts[k + 1], t1);
+      if (e <= s)
+        {
+          continue;
+        }
+      Point pa = a.GetPosition (s), pb = b.GetPosition (s);
+      Point qa = a.GetPosition (e), qb = b.GetPosition (e);
+      double px = pb.x - pa.x, py = pb.y - pa.y, pz = pb.z - pa.z;
+      double vx = ((qb.x - qa.x) - px) / (e - s);
+      double vy = ((qb.y - qa.y) - py) / (e - s);
+      double vz = ((qb.z - qa.z) - pz) / (e - s);
+      double qa2 = vx * vx + vy * vy + vz * vz;
+      double qb2 = 2 * (px * vx + py * vy + pz * vz);
+      double qc = px * px + py * py + pz * pz - range * range;
+      double disc = qb2 * qb2 - 4 * qa2 * qc;
+      if (qa2 <= 0 || disc < 0)
+        {
+          continue;
+        }
+      double root = std::sqrt (disc);
+      double r[2] = { (-qb2 - root) / (2 * qa2), (-qb2 + root) / (2 * qa2) };
+      for (int i = 0; i < 2; i++)
+        {
+          if (r[i] > 0 && r[i] <= e - s)
+            {
+              out.push_back (s + r[i]);
+            }
+        }
+    }
+}
+
+// RangeCrossings for every pair i < j with i = first, first + stride, ...
+inline void
+RangeCrossingsRows (const std::vector<Trajectory> &traj, double range, double t0, double t1,
+                    size_t first, size_t stride, std::vector<double> *out)
+{
+  for (size_t i = first; i < traj.size (); i += stride)
+    {
+      for (size_t j = i + 1; j < traj.size (); j++)
+        {
+          RangeCrossings (traj[i], traj[j], range, t0, t1, *out);
+        }
+    }
+}
+
+// RangeCrossings over all pairs of nodes, appended to out in no particular
+// order.  Rows are dealt to the threads in turn, which evens out their
+// shrinking lengths.
+inline void
+AllRangeCrossings (const std::vector<Trajectory> &traj, double range, double t0, double t1,
+                   unsigned threads, std::vector<double> &out)
+{
+  threads = std::max<size_t> (1, std::min<size_t> (threads, traj.size ()));
+  std::vector<std::vector<double> > found (threads);
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; t++)
+    {
+      pool.push_back (std::thread (&RangeCrossingsRows, std::cref (traj), range, t0, t1, t, threads, &found[t]));
+    }
+  RangeCrossingsRows (traj, range, t0, t1, 0, threads, &found[0]);
+  for (size_t t = 0; t < pool.size (); t++)
+    {
+      pool[t].join ();
+    }
+  for (unsigned t = 0; t < threads; t++)
+    {
+      out.insert (out.end (), found[t].begin (), found[t].end ());
+    }
+}
+
+// Route tables for a sequence of topologies known in advance: the full
+// table of the first step and, for each later step, the entries that
+// differ from the step before.  Steps are built in parallel, each worker
+// taking a contiguous run of steps.
+template <typename Index, typename Weight>
+class RouteTimeline
+{
+public:
+  // Step k starts at times[k] (ascending) and its topology is taken at the
+  // middle of the step, the last one ending at stop.  Steps that change
+  // nothing are merged into the one before.  Hop counts are exact for the
+  // whole step; Euclidean distances are those at its middle.
+  template <typename Metric>
+  void Build (const std::vector<Trajectory> &traj, double range, const std::vector<double> &times,
+              double stop, unsigned threads)
+  {
+    m_n = traj.size ();
+    size_t steps = times.size ();
+    std::vector<Step> built (steps);
+    threads = std::max (1u, std::min<unsigned> (threads, steps));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++)
+      {
+        pool.push_back (std::thread (&RouteTimeline::BuildRange<Metric>, this, std::cref (traj), range,
+                                     std::cref (times), stop, steps * t / threads, steps * (t + 1) / threads,
+                                     &built));
+      }
+    if (steps > 0)
+      {
+        BuildRange<Metric> (traj, range, times, stop, 0, steps / threads, &built);
+      }
+    for (size_t t = 0; t < pool.size (); t++)
+      {
+        pool[t].join ();
+      }
+
+    m_time.clear ();
+    m_offset.assign (1, 0);
+    m_labelOffset.assign (1, 0);
+    m_entries.clear ();
+    m_labels.clear ();
+    m_nComponents.clear ();
+    for (size_t k = 0; k < steps; k++)
+      {
+        if (k > 0 && built[k].entries.empty () && built[k].labels.empty ())
+          {
+            continue;
+          }
+        m_time.push_back (times[k]);
+        m_entries.insert (m_entries.end (), built[k].entries.begin (), built[k].entries.end ());
+        m_labels.insert (m_labels.end (), built[k].labels.begin (), built[k].labels.end ());
+        m_offset.push_back (m_entries.size ());
+        m_labelOffset.push_back (m_labels.size ());
+        m_nComponents.push_back (built[k].nComponents);
+        std::vector<Entry> ().swap (built[k].entries);
+      }
+  }
+
+  size_t GetNSteps (void) const
+  {
+    return m_time.size ();
+  }
+  double GetTime (size_t k) const
+  {
+    return m_time[k];
+  }
+  // Writes step 0 in full into n x n matrices and the labels.
+  void GetInitial (Index *pred, Weight *dist, std::vector<Index> &label, Index &nComponents) const
+  {
+    std::copy (m_pred0.begin (), m_pred0.end (), pred);
+    std::copy (m_dist0.begin (), m_dist0.end (), dist);
+    label = m_label0;
+    nComponents = m_nComponents.empty () ? 0 : m_nComponents[0];
+  }
+  // Moves the tables from step k - 1 to step k.
+  void Apply (size_t k, Index *pred, Weight *dist, std::vector<Index> &label, Index &nComponents) const
+  {
+    for (size_t e = m_offset[k]; e < m_offset[k + 1]; e++)
+      {
+        pred[m_entries[e].cell] = m_entries[e].pred;
+        dist[m_entries[e].cell] = m_entries[e].dist;
+      }
+    for (size_t e = m_labelOffset[k]; e < m_labelOffset[k + 1]; e++)
+      {
+        label[m_labels[e].first] = m_labels[e].second;
+      }
+    nComponents = m_nComponents[k];
+  }
+  size_t GetBytes (void) const
+  {
+    return m_time.capacity () * sizeof (double)
+           + (m_offset.capacity () + m_labelOffset.capacity ()) * sizeof (size_t)
+           + m_entries.capacity () * sizeof (Entry)
+           + m_labels.capacity () * sizeof (std::pair<Index, Index>)
+           + (m_nComponents.capacity () + m_pred0.capacity () + m_label0.capacity ()) * sizeof (Index)
+           + m_dist0.capacity () * sizeof (Weight);
+  }
+
+private:
+  struct Entry
+  {
+    uint32_t cell;
+    Index pred;
+    Weight dist;
+  };
+  struct Step
+  {
+    std::vector<Entry> entries;
+    std::vector<std::pair<Index, Index> > labels;
+    Index nComponents;
+  };
+
+  template <typename Metric>
+  void Table (const std::vector<Trajectory> &traj, double range, double t,
+              Index *pred, Weight *dist, std::vector<Index> &label, Index &nComponents) const
+  {
+    std::vector<Point> pos (m_n);
+    for (size_t i = 0; i < m_n; i++)
+      {
+        pos[i] = traj[i].GetPosition (t);
+      }
+    AdjacencyBuilder<Index, Weight, Metric> builder (m_n);
+    builder.AddPositions (pos, range);
+    Graph<Index, Weight> g = builder.Build ();
+    AllPairs<Index, Weight, Metric>::Run (g, pred, dist);
+    nComponents = Components (g, label);
+  }
+
+  template <typename Metric>
+  void BuildRange (const std::vector<Trajectory> &traj, double range, const std::vector<double> &times,
+                   double stop, size_t first, size_t last, std::vector<Step> *built)
+  {
+    if (first >= last)
+      {
+        return;
+      }
+    size_t cells = m_n * m_n;
+    std::vector<Index> prevPred (cells), curPred (cells);
+    std::vector<Weight> prevDist (cells), curDist (cells);
+    std::vector<Index> prevLabel, curLabel;
+    Index nComponents;
+    if (first > 0)
+      {
+        Table<Metric> (traj, range, Middle (times, stop, first - 1), cells ? &prevPred[0] : 0, cells ? &prevDist[0] : 0,
+                       prevLabel, nComponents);
+      }
+    for (size_t k = first; k < last; k++)
+      {
+        Step &step = (*built)[k];
+        Table<Metric> (traj, range, Middle (times, stop, k), cells ? &curPred[0] : 0, cells ? &curDist[0] : 0,
+                       curLabel, step.nComponents);
+        if (k == 0)
+          {
+            m_pred0 = curPred;
+            m_dist0 = curDist;
+            m_label0 = curLabel;
+          }
+        else
+          {
+            for (size_t c = 0; c < cells; c++)
+              {
+                if (curPred[c] != prevPred[c] || curDist[c] != prevDist[c])
+                  {
+                    Entry e = { (uint32_t) c, curPred[c], curDist[c] };
+                    step.entries.push_back (e);
+                  }
+              }
+            for (size_t i = 0; i < m_n; i++)
+              {
+                if (curLabel[i] != prevLabel[i])
+                  {
+                    step.labels.push_back (std::make_pair ((Index) i, curLabel[i]));
+                  }
+              }
+          }
+        prevPred.swap (curPred);
+        prevDist.swap (curDist);
+        prevLabel.swap (curLabel);
+      }
+  }
+
+  static double Middle (const std::vector<double> &times, double stop, size_t k)
+  {
+    double end = (k + 1 < times.size ()) ? times[k + 1] : std::max (stop, times[k]);
+    return (times[k] + end) / 2;
+  }
+
+  size_t m_n;
+  std::vector<double> m_time;
+  std::vector<size_t> m_offset;
+  std::vector<Entry> m_entries;
+  std::vector<size_t> m_labelOffset;
+  std::vector<std::pair<Index, Index> > m_labels;
+  std::vector<Index> m_nComponents;
+  std::vector<Index> m_pred0;
+  std::vector<Weight> m_dist0;
+  std::vector<Index> m_label0;
+};
+
+// Longest-prefix match on 32-bit keys, DIR-16-8-8 style: a root array
+// indexed by the first rootBits of the key, then 256-entry chunks for each
+// further byte where some prefix is longer.  Every slot holds the value of
+// the longest prefix covering it, so a lookup is one read per level, three
+// with the default root.  Each slot also records that prefix's length, so
+// prefixes may be inserted in any order.  A chunk costs 1280 bytes, one per
+// /16 (and /24) holding longer prefixes: cheap for host routes clustered in
+// subnets, much less so for prefixes scattered over the whole space.  The
+// root is only allocated with the first prefix, so an empty table is free.
+template <typename Value>
+class PrefixTable
+{
+public:
+  // rootBits is 8, 16 or 24: the root takes 5 << rootBits bytes
+  explicit PrefixTable (unsigned rootBits = 16)
+    : m_rootBits (rootBits)
+  {
+  }
+
+  // inserting a prefix again replaces its value
+  void Insert (uint32_t prefix, unsigned length, const Value &value)
+  {
+    prefix = length == 0 ? 0 : prefix & (0xffffffffu << (32 - length));
+    uint64_t key = (uint64_t) prefix << 6 | length;
+    typename std::map<uint64_t, uint32_t>::iterator it = m_prefixes.find (key);
+    if (it != m_prefixes.end ())
+      {
+        m_values[it->second - 1] = value;
+        return;
+      }
+    if (m_slot.empty ())
+      {
+        m_slot.assign ((size_t) 1 << m_rootBits, 0);
+        m_length.assign ((size_t) 1 << m_rootBits, 0);
+      }
+    m_values.push_back (value);
+    uint32_t id = m_values.size ();
+    m_prefixes[key] = id;
+    InsertAt (0, 0, m_rootBits, prefix, length, id);
+  }
+
+  bool Lookup (uint32_t key, Value &value) const
+  {
+    if (m_slot.empty ())
+      {
+        return false;
+      }
+    unsigned consumed = m_rootBits;
+    uint32_t e = m_slot[key >> (32 - m_rootBits)];
+    while (e & CHILD)
+      {
+        consumed += 8;
+        e = m_slot[(e & ~CHILD) + ((key >> (32 - consumed)) & 0xff)];
+      }
+    if (e == 0)
+      {
+        return false;
+      }
+    value = m_values[e - 1];
+    return true;
+  }
+
+  void Clear (void)
+  {
+    std::vector<uint32_t> ().swap (m_slot);
+    std::vector<uint8_t> ().swap (m_length);
+    m_values.clear ();
+    m_prefixes.clear ();
+  }
+
+  size_t GetNPrefixes (void) const
+  {
+    return m_values.size ();
+  }
+  size_t GetBytes (void) const
+  {
+    return m_slot.size () * (sizeof (uint32_t) + 1) + m_values.size () * sizeof (Value)
+           + m_prefixes.size () * (sizeof (uint64_t) + sizeof (uint32_t));
+  }
+
+private:
+  // slot contents: 0 empty, CHILD | first slot of a chunk, else value id
+  static const uint32_t CHILD = 0x80000000u;
+
+  // the level starting at slot base covers key bits [consumed, consumed + stride)
+  void InsertAt (uint32_t base, unsigned consumed, unsigned stride, uint32_t prefix, unsigned length, uint32_t id)
+  {
+    unsigned end = consumed + stride;
+    uint32_t idx = (prefix >> (32 - end)) & ((1u << stride) - 1);
+    if (length <= end)
+      {
+        uint32_t count = 1u << (end - length);
+        for (uint32_t k = idx; k < idx + count; k++)
+          {
+            Fill (base + k, length, id);
+          }
+        return;
+      }
+    uint32_t slot = base + idx;
+    if (!(m_slot[slot] & CHILD))
+      {
+        // the chunk starts out with what the slot covered
+        uint32_t chunk = m_slot.size ();
+        m_slot.resize (chunk + 256, m_slot[slot]);
+        m_length.resize (chunk + 256, m_length[slot]);
+        m_slot[slot] = CHILD | chunk;
+      }
+    InsertAt (m_slot[slot] & ~CHILD, end, 8, prefix, length, id);
+  }
+
+  void Fill (uint32_t slot, unsigned length, uint32_t id)
+  {
+    if (m_slot[slot] & CHILD)
+      {
+        uint32_t chunk = m_slot[slot] & ~CHILD;
+        for (uint32_t k = 0; k < 256; k++)
+          {
+            Fill (chunk + k, length, id);
+          }
+      }
+    else if (m_length[slot] <= length)
+      {
+        m_slot[slot] = id;
+        m_length[slot] = length;
+      }
+  }
+
+  unsigned m_rootBits;
+  std::vector<uint32_t> m_slot;
+  std::vector<uint8_t> m_length;
+  std::vector<Value> m_values;            // by id - 1
+  std::map<uint64_t, uint32_t> m_prefixes; // prefix << 6 | length -> id
+};
+
+template <typename Index, typename Weight, unsigned WORDS>
+const unsigned MultiSourceBfs<Index, Weight, WORDS>::BATCH;
+
+template <typename T>
+const size_t MatrixBuffer<T>::ALIGNMENT;
+template <typename T>
+const size_t MatrixBuffer<T>::HUGE_PAGE;
+template <typename Index, typename Weight>
+const size_t LinkFailureDiffs<Index, Weight>::NONE;
+template <typename Index, typename Weight>
+const Index ContractionHierarchy<Index, Weight>::NONE = std::numeric_limits<Index>::max ();
+template <typename Index, typename Weight>
+const uint32_t ContractionHierarchy<Index, Weight>::WITNESS_LIMIT;
+template <typename Index, typename Weight>
+const uint32_t ContractionHierarchy<Index, Weight>::ESTIMATE_LIMIT;
+template <typename Index, typename Weight>
+const Index LeafAggregation<Index, Weight>::NONE = std::numeric_limits<Index>::max ();
+template <typename Value>
+const uint32_t PrefixTable<Value>::CHILD;
+
+} // namespace modcore
+} // namespace ns3
+
+#endif /* MOD_ROUTING_CORE_H */
@@ -23,23 +23,124 @@
 #include "ns3/simulator.h"
 #include "mod-routing-table.h"
 #include "ns3/mobility-model.h"
+#include "ns3/enum.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include <cstdio>
+#include <fstream>
 #include <vector>
+#include <algorithm>
+#include <limits>
+#include <thread>
 #include <boost/lexical_cast.hpp>
 
 using namespace std;
 
+#if defined (__GNUC__)
+#define MOD_PREFETCH(addr) __builtin_prefetch (addr)
+#else
+#define MOD_PREFETCH(addr)
+#endif
+
 NS_LOG_COMPONENT_DEFINE ("ModRoutingTable");
 
 namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (ModRoutingTable);
 
+static const uint32_t NO_TREE = 0xffffffff;
+
 TypeId
 ModRoutingTable::GetTypeId ()
 {
   static TypeId tid = TypeId ("ns3::ModRoutingTable")
     .SetParent<Object> ()
     .AddConstructor<ModRoutingTable> ()
+    .AddAttribute ("Metric", "Link cost used by UpdateRoute.",
+                   EnumValue (ModRoutingTable::HOP_COUNT),
+                   MakeEnumAccessor (&ModRoutingTable::m_metric),
+                   MakeEnumChecker (ModRoutingTable::HOP_COUNT, "HopCount",
+                                    ModRoutingTable::EUCLIDEAN, "Euclidean"))
+    .AddAttribute ("Mode", "Build all pairs in UpdateRoute, or trees per source/destination on demand.",
+                   EnumValue (ModRoutingTable::EAGER),
+                   MakeEnumAccessor (&ModRoutingTable::m_mode),
+                   MakeEnumChecker (ModRoutingTable::EAGER, "Eager",
+                                    ModRoutingTable::LAZY_SOURCE, "LazySource",
+                                    ModRoutingTable::LAZY_DESTINATION, "LazyDestination",
+                                    ModRoutingTable::HIERARCHICAL, "Hierarchical",
+                                    ModRoutingTable::GEOGRAPHIC, "Geographic",
+                                    ModRoutingTable::ON_DEMAND, "OnDemand",
+                                    ModRoutingTable::CONTRACTION, "Contraction",
+                                    ModRoutingTable::AGGREGATED, "Aggregated"))
+    .AddAttribute ("Algorithm", "Hop-count all-pairs engine in Eager mode.",
+                   EnumValue (ModRoutingTable::AUTO),
+                   MakeEnumAccessor (&ModRoutingTable::m_algorithm),
+                   MakeEnumChecker (ModRoutingTable::AUTO, "Auto",
+                                    ModRoutingTable::BFS, "Bfs",
+                                    ModRoutingTable::MULTI_SOURCE_BFS, "MultiSourceBfs"))
+    .AddAttribute ("TreeCacheSize", "Shortest-path trees kept in the lazy modes.",
+                   UintegerValue (256),
+                   MakeUintegerAccessor (&ModRoutingTable::m_treeCacheSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("PairCacheSize", "Pair routes remembered in On-demand mode.",
+                   UintegerValue (1 << 20),
+                   MakeUintegerAccessor (&ModRoutingTable::m_pairCacheSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ClusterSize", "Target nodes per cluster in Hierarchical mode, 0 for sqrt (n).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ModRoutingTable::m_clusterSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("StretchSamples", "Random pairs whose stretch is traced after each Hierarchical UpdateRoute.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ModRoutingTable::m_stretchSamples),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("HoldDown", "Window in which update requests are merged into one recompute.",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&ModRoutingTable::m_holdDown),
+                   MakeTimeChecker ())
+    .AddAttribute ("FlapPenalty", "Dampening penalty added each time a node or link goes down (0 disables).",
+                   DoubleValue (1000),
+                   MakeDoubleAccessor (&ModRoutingTable::m_flapPenalty),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("SuppressLimit", "Penalty above which a flapping node or link is held down.",
+                   DoubleValue (2000),
+                   MakeDoubleAccessor (&ModRoutingTable::m_suppressLimit),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("ReuseLimit", "Penalty below which a held down node or link is used again (at least 1).",
+                   DoubleValue (750),
+                   MakeDoubleAccessor (&ModRoutingTable::m_reuseLimit),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("HalfLife", "Half-life of the dampening penalty.",
+                   TimeValue (Seconds (15)),
+                   MakeTimeAccessor (&ModRoutingTable::m_halfLife),
+                   MakeTimeChecker ())
+    .AddAttribute ("PrecomputeFailures", "In Eager mode, precompute the routes after every single "
+                   "link failure so one failure is applied without a recompute.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&ModRoutingTable::m_precomputeFailures),
+                   MakeBooleanChecker ())
+    .AddAttribute ("PrecomputeThreads", "Threads for PrecomputeFailures, 0 for one per core.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ModRoutingTable::m_precomputeThreads),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Kinetic", "Predict from node velocities when pairs cross txRange and "
+                   "recompute only then, instead of relying on periodic UpdateRoute calls.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&ModRoutingTable::m_kinetic),
+                   MakeBooleanChecker ())
+    .AddAttribute ("HugePages", "Ask for transparent huge pages behind the path matrices.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&ModRoutingTable::m_hugePages),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MulticastMode", "How multicast trees reach the members of a group.",
+                   EnumValue (ModRoutingTable::SHORTEST_PATH_TREE),
+                   MakeEnumAccessor (&ModRoutingTable::m_multicastMode),
+                   MakeEnumChecker (ModRoutingTable::SHORTEST_PATH_TREE, "ShortestPathTree",
+                                    ModRoutingTable::STEINER_TREE, "SteinerTree"))
+    .AddTraceSource ("Stretch", "Stretch of a sampled route in Hierarchical mode (see StretchSamples).",
+                     MakeTraceSourceAccessor (&ModRoutingTable::m_stretchTrace),
+                     "ns3::ModRoutingTable::StretchCallback")
     ;
   return tid;
 }
@@ -49,20 +150,155 @@ ModRoutingTable::ModRoutingTable ()
   m_modNext = 0;
   m_modDist = 0;
   m_txRange = 0;
+  m_nComponents = 0;
+  m_wired = false;
+  m_metric = HOP_COUNT;
+  m_hugePages = false;
+  m_mode = EAGER;
+  m_algorithm = AUTO;
+  m_lastAlgorithm = BFS;
+  m_treeCacheSize = 256;
+  m_pairCacheSize = 1 << 20;
+  m_clusterSize = 0;
+  m_geoSpeed = 0;
+  m_nPairSearches = 0;
+  m_stretchSamples = 0;
+  m_stretchRng = CreateObject<UniformRandomVariable> ();
+  m_holdDown = MilliSeconds (100);
+  m_flapPenalty = 1000;
+  m_suppressLimit = 2000;
+  m_reuseLimit = 750;
+  m_halfLife = Seconds (15);
+  m_dirty = false;
+  m_precomputeFailures = false;
+  m_precomputeThreads = 0;
+  m_activeDiff = FailureDiffs::NONE;
+  m_kinetic = false;
+  m_kineticRange = 0;
+  m_nCrossings = 0;
+  m_timelineStep = 0;
+  m_nUpdateRequests = 0;
+  m_nScheduledUpdates = 0;
+  m_multicastMode = SHORTEST_PATH_TREE;
 }
 ModRoutingTable::~ModRoutingTable ()
-{}
+{
+  m_updateEvent.Cancel ();
+  m_crossingEvent.Cancel ();
+  m_timelineEvent.Cancel ();
+  for (std::map<LinkKey, LinkState>::iterator it = m_state.begin (); it != m_state.end (); ++it)
+    {
+      it->second.reuse.Cancel ();
+    }
+}
+
+// The mobility models may outlive the table; they must not call it back.
+void
+ModRoutingTable::DoDispose (void)
+{
+  std::map<Ptr<const MobilityModel>, uint32_t>::const_iterator it = m_mobilityIndex.begin ();
+  for (; it != m_mobilityIndex.end (); ++it)
+    {
+      ConstCast<MobilityModel> (it->first)->TraceDisconnectWithoutContext (
+        "CourseChange", MakeCallback (&ModRoutingTable::CourseChanged, this));
+    }
+  m_mobilityIndex.clear ();
+  m_updateEvent.Cancel ();
+  m_crossingEvent.Cancel ();
+  m_timelineEvent.Cancel ();
+  Object::DoDispose ();
+}
 
 void 
 ModRoutingTable::AddRoute (Ipv4Address srcAddr, Ipv4Address relayAddr, Ipv4Address dstAddr)
 {
-  NS_LOG_FUNCTION (srcAddr << relayAddr << dstAddr);
+  AddRoute (srcAddr, relayAddr, dstAddr, Ipv4Mask::GetOnes ());
+}
+
+void
+ModRoutingTable::AddRoute (Ipv4Address srcAddr, Ipv4Address relayAddr, Ipv4Address dstAddr, Ipv4Mask dstMask)
+{
+  NS_LOG_FUNCTION (srcAddr << relayAddr << dstAddr << dstMask);
   ModtableEntry se;
   se.srcAddr = srcAddr;
   se.relayAddr = relayAddr;
-  se.dstAddr = dstAddr;
+  se.dstAddr = dstAddr.CombineMask (dstMask);
+  se.dstMask = dstMask;
   
   m_modtable.push_back (se);
+  InsertStatic (se);
+}
+
+// The prefix tables cannot drop a prefix, so they are rebuilt from the
+// remaining routes.
+void
+ModRoutingTable::RemoveRoute (Ipv4Address srcAddr, Ipv4Address dstAddr, Ipv4Mask dstMask)
+{
+  NS_LOG_FUNCTION (srcAddr << dstAddr << dstMask);
+  dstAddr = dstAddr.CombineMask (dstMask);
+  size_t before = m_modtable.size ();
+  for (std::list<ModtableEntry>::iterator it = m_modtable.begin (); it != m_modtable.end (); )
+    {
+      if (it->srcAddr == srcAddr && it->dstAddr == dstAddr && it->dstMask == dstMask)
+        {
+          it = m_modtable.erase (it);
+        }
+      else
+        {
+          ++it;
+        }
+    }
+  if (m_modtable.size () == before)
+    {
+      return;
+    }
+  m_staticRoutes.Clear ();
+  m_scopedRoutes.clear ();
+  for (std::list<ModtableEntry>::const_iterator it = m_modtable.begin (); it != m_modtable.end (); ++it)
+    {
+      InsertStatic (*it);
+    }
+}
+
+uint32_t
+ModRoutingTable::GetNStaticRoutes (void) const
+{
+  return m_modtable.size ();
+}
+
+void
+ModRoutingTable::InsertStatic (const ModtableEntry &se)
+{
+  if (se.srcAddr == Ipv4Address::GetAny ())
+    {
+      m_staticRoutes.Insert (se.dstAddr.Get (), se.dstMask.GetPrefixLength (), se.relayAddr);
+      return;
+    }
+  std::map<Ipv4Address, modcore::PrefixTable<Ipv4Address> >::iterator it = m_scopedRoutes.find (se.srcAddr);
+  if (it == m_scopedRoutes.end ())
+    {
+      // per-source tables are small, so a 256-slot root
+      it = m_scopedRoutes.insert (std::make_pair (se.srcAddr, modcore::PrefixTable<Ipv4Address> (8))).first;
+    }
+  it->second.Insert (se.dstAddr.Get (), se.dstMask.GetPrefixLength (), se.relayAddr);
+}
+
+bool
+ModRoutingTable::LookupStatic (Ipv4Address srcAddr, Ipv4Address dstAddr, Ipv4Address &relay) const
+{
+  if (m_modtable.empty ())
+    {
+      return false;
+    }
+  if (!m_scopedRoutes.empty ())
+    {
+      std::map<Ipv4Address, modcore::PrefixTable<Ipv4Address> >::const_iterator it = m_scopedRoutes.find (srcAddr);
+      if (it != m_scopedRoutes.end () && it->second.Lookup (dstAddr.Get (), relay))
+        {
+          return true;
+        }
+    }
+  return m_staticRoutes.Lookup (dstAddr.Get (), relay);
 }
 std::vector<Ipv4Address> findListOfAttachedRelays(Ipv4Address currentNode){
    // return the list of attached nodes to currentNode
@@ -76,44 +312,61 @@ ModRoutingTable::AddNode (Ptr<Node> node, Ipv4Address addr)
   ModNodeEntry sn;
   sn.node = node;
   sn.addr = addr;
+  m_addrIndex.insert (std::make_pair (addr, (uint32_t) m_nodeTable.size ()));
+  Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
+  if (mobility != 0)
+    {
+      m_mobilityIndex[mobility] = m_nodeTable.size ();
+      mobility->TraceConnectWithoutContext ("CourseChange", MakeCallback (&ModRoutingTable::CourseChanged, this));
+    }
   m_nodeTable.push_back (sn);
 }
 
+// Wired links.  Once any link is added, adjacency comes from the links
+// instead of from node positions and the transmission range.
+void
+ModRoutingTable::AddLink (Ipv4Address addr1, Ipv4Address addr2)
+{
+  NS_LOG_FUNCTION (addr1 << addr2);
+  uint32_t i = GetIndex (addr1);
+  uint32_t j = GetIndex (addr2);
+  NS_ASSERT_MSG (i < m_nodeTable.size () && j < m_nodeTable.size (), "AddLink before AddNode");
+  m_links.insert (std::make_pair (std::min (i, j), std::max (i, j)));
+  m_wired = true;
+}
+
+void
+ModRoutingTable::RemoveLink (Ipv4Address addr1, Ipv4Address addr2)
+{
+  NS_LOG_FUNCTION (addr1 << addr2);
+  uint32_t i = GetIndex (addr1);
+  uint32_t j = GetIndex (addr2);
+  m_links.erase (std::make_pair (std::min (i, j), std::max (i, j)));
+}
+
 Ipv4Address
 ModRoutingTable::LookupRoute (Ipv4Address srcAddr, Ipv4Address dstAddr)
 {
-    uint16_t i = 0, j = 0;
     Ipv4Address relay;
-    std::vector<ModNodeEntry>::iterator it = m_nodeTable.begin ();
-    
-    for (; it != m_nodeTable.end ();++it)
+    if (LookupStatic (srcAddr, dstAddr, relay))
       {
-        if (it->addr == srcAddr)
-          {
-            break;
-          }
-        i++;
+        NS_LOG_INFO ("@@ static " << srcAddr << " " << dstAddr << " " << relay);
+        return relay;
       }
-    it = m_nodeTable.begin ();
-    for (; it != m_nodeTable.end ();++it)
+    uint32_t i = GetIndex (srcAddr);
+    uint32_t j = GetIndex (dstAddr);
+    if (!IsReachable (i, j))
       {
-        if (it->addr == dstAddr)
-          {
-            break;
-          }
-        j++;
+        NS_LOG_DEBUG ("No Path Exists!");
+        return srcAddr;
       }
     
-    uint16_t k;
-    do
-      {
-        k = j;
-        j = m_modNext [i * m_nodeTable.size() + j];
-        NS_LOG_INFO ("@@ " << i << " " << j << " " << k);
-      }
-    while (i != j);
+    uint32_t k = FirstHop (i, j);
+    NS_LOG_INFO ("@@ " << i << " " << j << " " << k);
     
-    if (DistFromTable (i, k) > m_txRange)
+    // the table may be older than the last topology event
+    if (IsDown (i, k) || IsDown (k, k)
+        || (m_wired ? !IsLinked (i, k) : DistFromTable (i, k) > m_txRange))
       {
         NS_LOG_DEBUG ("No Path Exists!");
         return srcAddr;
@@ -123,123 +376,1736 @@ ModRoutingTable::LookupRoute (Ipv4Address srcAddr, Ipv4Address dstAddr)
     return se.addr;
 }
 
-// Find shortest paths for all pairs using Floyd-Warshall algorithm 
-void 
-ModRoutingTable::UpdateRoute (double txRange)
+// Nodes on the shortest path from srcAddr to dstAddr, excluding srcAddr.
+// Empty if there is no path.
+std::vector<uint32_t>
+ModRoutingTable::GetPath (Ipv4Address srcAddr, Ipv4Address dstAddr)
 {
-  NS_LOG_FUNCTION ("");
+  std::vector<uint32_t> path;
+  uint32_t n = m_nodeTable.size ();
+  uint32_t i = GetIndex (srcAddr);
+  uint32_t j = GetIndex (dstAddr);
+  if (m_mode == EAGER)
+    {
+      if (m_modDist != 0 && i < n && j < n)
+        {
+          modcore::NextHopStore<uint32_t, double> (n, m_modNext, m_modDist).GetPath (i, j, path);
+        }
+      return path;
+    }
+  if (i == j || !IsReachable (i, j))
+    {
+      return path;
+    }
+  if (m_mode == GEOGRAPHIC)
+    {
+      if (GeoLength (i, j, &path) == HUGE_VAL)
+        {
+          path.clear ();
+        }
+      return path;
+    }
+  if (m_mode == ON_DEMAND)
+    {
+      for (uint32_t k = i; k != j; )
+        {
+          k = GetPairRoute (k, j).next;
+          path.push_back (k);
+        }
+      return path;
+    }
+  if (m_mode == CONTRACTION)
+    {
+      m_contraction.GetPath (i, j, path);
+      return path;
+    }
+  if (m_mode == AGGREGATED)
+    {
+      m_aggregation.GetPath (i, j, path);
+      return path;
+    }
+  if (m_mode == HIERARCHICAL)
+    {
+      for (uint32_t k = i; k != j; )
+        {
+          k = m_hierarchy.GetNextHop (k, j);
+          path.push_back (k);
+        }
+      return path;
+    }
+  if (m_mode == LAZY_DESTINATION)
+    {
+      const ShortestPathTree &tree = GetTree (j);
+      for (uint32_t k = tree.pred[i]; ; k = tree.pred[k])
+        {
+          path.push_back (k);
+          if (k == j)
+            {
+              break;
+            }
+        }
+      return path;
+    }
+  const ShortestPathTree &tree = GetTree (i);
+  for (uint32_t k = j; k != i; k = tree.pred[k])
+    {
+      path.push_back (k);
+    }
+  std::reverse (path.begin (), path.end ());
+  return path;
+}
 
-  m_txRange = txRange;
-  uint16_t n = m_nodeTable.size(); // number of nodes
-  uint16_t i, j, k; //loop counters
-  double distance;
+Ipv4Address
+ModRoutingTable::GetAddress (uint32_t index) const
+{
+  return m_nodeTable.at (index).addr;
+}
+
+Ptr<Node>
+ModRoutingTable::GetNode (Ipv4Address addr) const
+{
+  uint32_t i = GetIndex (addr);
+  return i < m_nodeTable.size () ? m_nodeTable[i].node : Ptr<Node> ();
+}
+
+uint32_t
+ModRoutingTable::GetNNodes (void) const
+{
+  return m_nodeTable.size ();
+}
+
+void
+ModRoutingTable::LookupRouteBatch (const Ipv4Address* srcAddr, const Ipv4Address* dstAddr, uint32_t count,
+                                   Ipv4Address* relayAddr, double* distance)
+{
+  NS_LOG_FUNCTION (count);
+  std::vector<uint32_t> src (count), dst (count), relay (relayAddr != 0 ? count : 0);
+  for (uint32_t q = 0; q < count; q++)
+    {
+      src[q] = GetIndex (srcAddr[q]);
+      dst[q] = GetIndex (dstAddr[q]);
+    }
+  LookupRouteBatch (count ? &src[0] : 0, count ? &dst[0] : 0, count,
+                    relayAddr != 0 && count ? &relay[0] : 0, distance);
+  if (relayAddr != 0)
+    {
+      // static routes override the relay, not the distance
+      for (uint32_t q = 0; q < count; q++)
+        {
+          if (!LookupStatic (srcAddr[q], dstAddr[q], relayAddr[q]))
+            {
+              relayAddr[q] = relay[q] < m_nodeTable.size () ? m_nodeTable[relay[q]].addr : srcAddr[q];
+            }
+        }
+    }
+}
+
+// Queries are answered from the table built by the last UpdateRoute; unlike
+// LookupRoute, the first hop is not re-checked against current positions.
+void
+ModRoutingTable::LookupRouteBatch (const uint32_t* src, const uint32_t* dst, uint32_t count,
+                                   uint32_t* relay, double* distance)
+{
+  NS_LOG_FUNCTION (count);
+  uint32_t n = m_nodeTable.size ();
+  if (count == 0)
+    {
+      return;
+    }
+  if (m_mode != EAGER)
+    {
+      // trees come from the cache one query at a time
+      for (uint32_t q = 0; q < count; q++)
+        {
+          bool ok = IsReachable (src[q], dst[q]);
+          if (relay != 0)
+            {
+              relay[q] = ok ? FirstHop (src[q], dst[q]) : src[q];
+            }
+          if (distance != 0)
+            {
+              distance[q] = ok ? PathDistance (src[q], dst[q]) : HUGE_VAL;
+            }
+        }
+      return;
+    }
+  if (m_modNext == 0 || m_modDist == 0 || n == 0)
+    {
+      for (uint32_t q = 0; q < count; q++)
+        {
+          if (relay != 0)
+            {
+              relay[q] = src[q];
+            }
+          if (distance != 0)
+            {
+              distance[q] = HUGE_VAL;
+            }
+        }
+      return;
+    }
 
-  //initialize data structures
-  if (m_modNext != 0)
+  // counting sort of the queries by source row (out-of-range sources last)
+  std::vector<uint32_t> start (n + 2, 0);
+  for (uint32_t q = 0; q < count; q++)
+    {
+      start[std::min<uint32_t> (src[q], n) + 1]++;
+    }
+  for (uint32_t r = 0; r <= n; r++)
     {
-      delete m_modNext;
+      start[r + 1] += start[r];
     }
-  if (m_modDist != 0)
+  std::vector<uint32_t> order (count);
+  std::vector<uint32_t> fill (start.begin (), start.end () - 1);
+  for (uint32_t q = 0; q < count; q++)
     {
-      delete m_modDist;
+      order[fill[std::min<uint32_t> (src[q], n)]++] = q;
     }
 
-  double* dist = new double [n * n];
-  uint16_t* pred = new uint16_t [n * n];
+  // first hop memo for the current row, reset only where it was written
+  const uint32_t none = std::numeric_limits<uint32_t>::max ();
+  std::vector<uint32_t> firstHop (n, none);
+  std::vector<uint32_t> touched;
+  std::vector<uint32_t> chain;
 
-  //algorithm initialization
-  for (i = 0; i < n; i++)
+  for (uint32_t g = 0; g < count; )
     {
-      for (j = 0; j < n; j++)
+      uint32_t i = src[order[g]];
+      uint32_t end = g;
+      while (end < count && src[order[end]] == i)
+        {
+          end++;
+        }
+      // prefetch the entries the next row's queries start from
+      uint32_t ahead = end;
+      if (ahead < count && src[order[ahead]] < n)
+        {
+          uint32_t next = src[order[ahead]];
+          for (; ahead < count && src[order[ahead]] == next; ahead++)
+            {
+              uint32_t d = std::min<uint32_t> (dst[order[ahead]], n - 1);
+              MOD_PREFETCH (&m_modNext[(size_t) next * n + d]);
+              MOD_PREFETCH (&m_modDist[(size_t) next * n + d]);
+            }
+        }
+
+      for (; g < end; g++)
         {
+          uint32_t q = order[g];
+          uint32_t j = dst[q];
+          if (!IsReachable (i, j))
+            {
+              if (relay != 0)
+                {
+                  relay[q] = i;
+                }
+              if (distance != 0)
+                {
+                  distance[q] = HUGE_VAL;
+                }
+              continue;
+            }
+          if (distance != 0)
+            {
+              distance[q] = m_modDist[(size_t) i * n + j];
+            }
+          if (relay == 0)
+            {
+              continue;
+            }
           if (i == j)
             {
-              dist [i * n + j] = 0;
+              relay[q] = i;
+              continue;
             }
-          else
+
+          // walk predecessors until a node whose first hop is known
+          uint32_t k = j;
+          uint32_t hop;
+          while (true)
             {
-              distance = DistFromTable (i, j);
-              if (distance > 0 && distance <= txRange)
+              if (firstHop[k] != none)
                 {
-	                //dist [i * n + j] = distance; // shortest distance
-                  dist [i * n + j] = 1; // shortest hop
+                  hop = firstHop[k];
+                  break;
                 }
-              else
+              chain.push_back (k);
+              uint32_t p = m_modNext[(size_t) i * n + k];
+              if (p == i)
                 {
-	                dist [i * n + j] = HUGE_VAL;
+                  hop = k;
+                  break;
                 }
-              pred [i * n + j] = i;
+              k = p;
+            }
+          for (std::vector<uint32_t>::iterator c = chain.begin (); c != chain.end (); ++c)
+            {
+              firstHop[*c] = hop;
+              touched.push_back (*c);
             }
+          chain.clear ();
+          relay[q] = hop;
+        }
+
+      for (std::vector<uint32_t>::iterator t = touched.begin (); t != touched.end (); ++t)
+        {
+          firstHop[*t] = none;
         }
+      touched.clear ();
     }
-    
-  // Main loop of the algorithm
-  for (k = 0; k < n; k++)
+}
+
+// Find shortest paths for all pairs.  The graph and the engines live in
+// mod-routing-core.h; this only gathers the topology and owns the matrices.
+void 
+ModRoutingTable::UpdateRoute (double txRange)
+{
+  NS_LOG_FUNCTION ("");
+
+  m_txRange = txRange;
+  m_dirty = false;
+  m_multicastTrees.clear ();
+  uint32_t n = m_nodeTable.size(); // number of nodes
+  if (m_timelineEvent.IsRunning ())
+    {
+      NS_LOG_LOGIC ("recompute drops the precomputed timeline");
+      m_timelineEvent.Cancel ();
+    }
+
+  if (m_mode == GEOGRAPHIC)
     {
-      for (i = 0; i < n; i++)
+      // nothing to compute: positions are read hop by hop
+      m_nextBuffer.Release ();
+      m_distBuffer.Release ();
+      m_modNext = 0;
+      m_modDist = 0;
+      m_treeOf.assign (n, NO_TREE);
+      m_component.assign (n, 0);
+      m_nComponents = n > 0 ? 1 : 0;
+      BuildGeoGrid ();
+      return;
+    }
+
+  BuildGraph ();
+
+  // reachability index
+  m_nComponents = modcore::Components (m_graph, m_component);
+  NS_LOG_INFO (m_nComponents << " partition(s)");
+  m_failureDiffs.Clear ();
+  m_activeDiff = FailureDiffs::NONE;
+
+  if (m_kinetic && !m_wired && m_kineticRange != m_txRange)
+    {
+      m_kineticRange = m_txRange;
+      m_crossings.clear ();
+      m_crossingOf.clear ();
+      for (uint32_t i = 0; i < n; i++)
         {
-          for (j = 0; j < n; j++)
+          for (uint32_t j = i + 1; j < n; j++)
             {
-              distance = std::min (dist[i * n + j], dist[i * n + k] + dist[k * n + j]);
-              if (distance != dist[i * n + j])
-                {
-                  dist[i * n + j] = distance;
-                  pred[i * n + j] = pred[k * n + j];
-                }
+              PredictCrossing (i, j);
             }
         }
+      ScheduleCrossing ();
     }
-    
-  m_modNext = pred; // predicate matrix, useful in reconstructing shortest routes
-  m_modDist = dist;
-  
-  string str;
-  for (i = 0; i < n; i++)
+
+  if (m_mode != EAGER)
     {
-      for (j = 0; j < n; j++)
-      {
-        str.append (boost::lexical_cast<string>( pred[i * n + j] ));
-        str.append (" ");
-      }
-      NS_LOG_INFO (str);
-      str.erase (str.begin(), str.end());
+      // cached trees are stale; their slots are reused
+      m_nextBuffer.Release ();
+      m_distBuffer.Release ();
+      m_modNext = 0;
+      m_modDist = 0;
+      m_treeOf.assign (n, NO_TREE);
+      m_pairRoutes.clear ();
+      m_pairLru.clear ();
+      if (m_mode == HIERARCHICAL)
+        {
+          std::vector<uint32_t> key;
+          size_t size = ClusterKeys (key);
+          if (m_metric == EUCLIDEAN)
+            {
+              m_hierarchy.Build<modcore::EuclideanMetric> (m_graph, key, size);
+            }
+          else
+            {
+              m_hierarchy.Build<modcore::HopCountMetric> (m_graph, key, size);
+            }
+          NS_LOG_INFO (m_hierarchy.GetNClusters () << " clusters, " << m_hierarchy.GetBytes () << " bytes");
+          SampleStretch ();
+        }
+      if (m_mode == CONTRACTION)
+        {
+          unsigned threads = m_precomputeThreads > 0 ? m_precomputeThreads : std::thread::hardware_concurrency ();
+          m_contraction.Update (m_graph, threads);
+          NS_LOG_INFO (m_contraction.GetNRecontracted () << " node(s) contracted, "
+                       << m_contraction.GetNArcs () << " upward arcs");
+        }
+      if (m_mode == AGGREGATED)
+        {
+          if (m_metric == EUCLIDEAN)
+            {
+              m_aggregation.Build<modcore::EuclideanMetric> (m_graph);
+            }
+          else
+            {
+              m_aggregation.Build<modcore::HopCountMetric> (m_graph);
+            }
+          NS_LOG_INFO (m_aggregation.GetNCore () << " of " << n << " nodes keep their own rows");
+        }
+      return;
     }
-}
+  m_trees.clear ();
+  m_treeOf.clear ();
+  m_lru.clear ();
+  m_lruPos.clear ();
 
-// Get direct-distance between two nodes
-double
-ModRoutingTable::GetDistance (Ipv4Address srcAddr, Ipv4Address dstAddr)
-{
-    uint16_t i = 0, j = 0;
-    uint16_t n = m_nodeTable.size(); // number of nodes
-    Ipv4Address relay;
-    std::vector<ModNodeEntry>::iterator it = m_nodeTable.begin ();
-    
-    for (; it != m_nodeTable.end ();++it)
-      {
-        if (it->addr == srcAddr)
-          {
-            break;
-          }
-        i++;
-      }
-    it = m_nodeTable.begin ();
-    for (; it != m_nodeTable.end ();++it)
-      {
-        if (it->addr == dstAddr)
+  //initialize data structures; the engines overwrite every entry
+  size_t cells = (size_t) n * n;
+  if (!m_nextBuffer.Reserve (cells, m_hugePages) || !m_distBuffer.Reserve (cells, m_hugePages))
+    {
+      NS_FATAL_ERROR ("Cannot allocate the path matrices for " << n << " nodes");
+    }
+  double* dist = m_distBuffer.Get ();
+  uint32_t* pred = m_nextBuffer.Get ();
+
+  unsigned threads = m_precomputeThreads > 0 ? m_precomputeThreads : std::thread::hardware_concurrency ();
+  if (m_metric == EUCLIDEAN)
+    {
+      modcore::AllPairs<uint32_t, double, modcore::EuclideanMetric>::Run (m_graph, pred, dist);
+      if (m_precomputeFailures)
+        {
+          m_failureDiffs.Build<modcore::EuclideanMetric> (m_graph, pred, dist, threads);
+        }
+    }
+  else
+    {
+      typedef modcore::MultiSourceBfs<uint32_t, double> MsBfs;
+      m_lastAlgorithm = m_algorithm;
+      if (m_lastAlgorithm == AUTO)
+        {
+          m_lastAlgorithm = MsBfs::IsFaster (n, m_graph.GetNArcs ()) ? MULTI_SOURCE_BFS : BFS;
+        }
+      if (m_lastAlgorithm == MULTI_SOURCE_BFS)
+        {
+          MsBfs::Run (m_graph, pred, dist);
+        }
+      else
+        {
+          modcore::AllPairs<uint32_t, double, modcore::HopCountMetric>::Run (m_graph, pred, dist);
+        }
+      if (m_precomputeFailures)
+        {
+          m_failureDiffs.Build<modcore::HopCountMetric> (m_graph, pred, dist, threads);
+        }
+    }
+
+  m_modNext = pred; // predicate matrix, useful in reconstructing shortest routes
+  m_modDist = dist;
+
+  if (g_log.IsEnabled (LOG_INFO))
+    {
+      string str;
+      for (uint32_t i = 0; i < n; i++)
+        {
+          for (uint32_t j = 0; j < n; j++)
           {
-            break;
+            str.append (boost::lexical_cast<string>( pred[i * n + j] ));
+            str.append (" ");
           }
-        j++;
-      }
-    
-    return m_modDist [i * n + j];
+          NS_LOG_INFO (str);
+          str.erase (str.begin(), str.end());
+        }
+    }
 }
 
-double 
-ModRoutingTable::DistFromTable (uint16_t i, uint16_t j)
+template <typename Builder>
+void
+ModRoutingTable::ExcludeDown (Builder &builder) const
 {
-  Vector pos1, pos2;
+  uint32_t n = m_nodeTable.size ();
+  for (std::map<LinkKey, LinkState>::const_iterator it = m_state.begin (); it != m_state.end (); ++it)
+    {
+      if (it->first.second >= n || !(it->second.down || it->second.suppressed))
+        {
+          continue;
+        }
+      if (it->first.first == it->first.second)
+        {
+          builder.Isolate (it->first.first);
+        }
+      else
+        {
+          builder.RemoveEdge (it->first.first, it->first.second);
+        }
+    }
+}
+
+// Adjacency for the current node positions (or the wired links), weighted
+// by the configured metric.
+void
+ModRoutingTable::BuildGraph (void)
+{
+  uint32_t n = m_nodeTable.size ();
+  if (m_wired)
+    {
+      modcore::AdjacencyBuilder<uint32_t, double, modcore::HopCountMetric> builder (n);
+      std::set<std::pair<uint32_t, uint32_t> >::const_iterator it = m_links.begin ();
+      for (; it != m_links.end (); ++it)
+        {
+          builder.AddEdge (it->first, it->second, 1);
+        }
+      ExcludeDown (builder);
+      m_graph = builder.Build ();
+      m_graphPos.clear ();
+      return;
+    }
+
+  // kept for the ON_DEMAND search bounds
+  std::vector<modcore::Point> &pos = m_graphPos;
+  pos.resize (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Vector v = m_nodeTable[i].node->GetObject<MobilityModel> ()->GetPosition ();
+      pos[i] = modcore::Point (v.x, v.y, v.z);
+    }
+  if (m_metric == EUCLIDEAN)
+    {
+      modcore::AdjacencyBuilder<uint32_t, double, modcore::EuclideanMetric> builder (n);
+      builder.AddPositions (pos, m_txRange);
+      ExcludeDown (builder);
+      m_graph = builder.Build ();
+    }
+  else
+    {
+      modcore::AdjacencyBuilder<uint32_t, double, modcore::HopCountMetric> builder (n);
+      builder.AddPositions (pos, m_txRange);
+      ExcludeDown (builder);
+      m_graph = builder.Build ();
+    }
+}
+
+// Clustering key of each node for Hierarchical mode: a square grid cell
+// sized for about ClusterSize nodes per cell, or a BFS ball when wired.
+// Returns that target size.
+size_t
+ModRoutingTable::ClusterKeys (std::vector<uint32_t> &key) const
+{
+  uint32_t n = m_nodeTable.size ();
+  size_t size = m_clusterSize > 0 ? m_clusterSize : std::max (1.0, std::sqrt ((double) n));
+  if (m_wired)
+    {
+      modcore::GrowClusters (m_graph, size, key);
+      return size;
+    }
+  std::vector<Vector> pos (n);
+  double minX = HUGE_VAL, minY = HUGE_VAL, maxX = -HUGE_VAL, maxY = -HUGE_VAL;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      pos[i] = m_nodeTable[i].node->GetObject<MobilityModel> ()->GetPosition ();
+      minX = std::min (minX, pos[i].x);
+      maxX = std::max (maxX, pos[i].x);
+      minY = std::min (minY, pos[i].y);
+      maxY = std::max (maxY, pos[i].y);
+    }
+  // the second term covers nodes spread along a line
+  double ratio = (double) size / std::max<uint32_t> (n, 1);
+  double side = std::max (std::sqrt ((maxX - minX) * (maxY - minY) * ratio),
+                          std::max (maxX - minX, maxY - minY) * ratio);
+  if (!(side > 0))
+    {
+      side = 1;
+    }
+  uint32_t rows = (maxY - minY) / side + 1;
+  key.resize (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      key[i] = (uint32_t) ((pos[i].x - minX) / side) * rows + (uint32_t) ((pos[i].y - minY) / side);
+    }
+  return size;
+}
+
+// Length of the route the hierarchy takes from i to j.
+double
+ModRoutingTable::RouteLength (uint32_t i, uint32_t j)
+{
+  double length = 0;
+  for (uint32_t k = i; k != j; )
+    {
+      uint32_t next = m_hierarchy.GetNextHop (k, j);
+      if (next == k)
+        {
+          return HUGE_VAL;
+        }
+      length += LinkWeight (k, next);
+      k = next;
+    }
+  return length;
+}
+
+double
+ModRoutingTable::LinkWeight (uint32_t i, uint32_t j) const
+{
+  const uint32_t *arc = std::lower_bound (m_graph.Begin (i), m_graph.End (i), j);
+  return m_graph.Weights (i)[arc - m_graph.Begin (i)];
+}
+
+// ON_DEMAND: the memoized route from i to j, searched on a miss.  Subpaths
+// of a shortest path are shortest, so the search also answers every node
+// on the path, which is where the packet's next lookups come from.
+const ModRoutingTable::PairRoute&
+ModRoutingTable::GetPairRoute (uint32_t i, uint32_t j)
+{
+  uint64_t key = (uint64_t) i << 32 | j;
+  std::map<uint64_t, PairRoute>::iterator it = m_pairRoutes.find (key);
+  if (it != m_pairRoutes.end ())
+    {
+      m_pairLru.splice (m_pairLru.begin (), m_pairLru, it->second.lru);
+      return it->second;
+    }
+  m_nPairSearches++;
+  std::vector<uint32_t> path;
+  double dist;
+  if (m_wired || m_graphPos.size () != m_graph.GetN ())
+    {
+      dist = m_pairSearch.Run (m_graph, i, j, modcore::NoBound (), path);
+    }
+  else if (m_metric == EUCLIDEAN)
+    {
+      dist = m_pairSearch.Run (m_graph, i, j, modcore::LineBound (m_graphPos, m_graphPos[j]), path);
+    }
+  else
+    {
+      dist = m_pairSearch.Run (m_graph, i, j, modcore::HopBound (m_graphPos, m_graphPos[j], m_txRange), path);
+    }
+  NS_LOG_LOGIC ("search " << i << "->" << j << ": " << path.size () << " hops");
+  if (path.empty ())
+    {
+      return MemoPairRoute (key, i, i == j ? 0 : HUGE_VAL);
+    }
+  std::vector<double> remaining (path.size ());
+  uint32_t k = i;
+  for (size_t h = 0; h < path.size (); h++)
+    {
+      remaining[h] = dist;
+      dist -= LinkWeight (k, path[h]);
+      k = path[h];
+    }
+  // nearest the destination first, so the pair asked for is the most
+  // recently used whatever the cache size
+  for (size_t h = path.size () - 1; h > 0; h--)
+    {
+      MemoPairRoute ((uint64_t) path[h - 1] << 32 | j, path[h], remaining[h]);
+    }
+  return MemoPairRoute (key, path[0], remaining[0]);
+}
+
+// Remembers a route unless already known, evicting the least recently
+// used ones beyond PairCacheSize.
+const ModRoutingTable::PairRoute&
+ModRoutingTable::MemoPairRoute (uint64_t key, uint32_t next, double dist)
+{
+  std::map<uint64_t, PairRoute>::iterator it = m_pairRoutes.find (key);
+  if (it == m_pairRoutes.end ())
+    {
+      m_pairLru.push_front (key);
+      PairRoute route = { next, dist, m_pairLru.begin () };
+      it = m_pairRoutes.insert (std::make_pair (key, route)).first;
+    }
+  else
+    {
+      m_pairLru.splice (m_pairLru.begin (), m_pairLru, it->second.lru);
+    }
+  while (m_pairRoutes.size () > m_pairCacheSize)
+    {
+      m_pairRoutes.erase (m_pairLru.back ());
+      m_pairLru.pop_back ();
+    }
+  return it->second;
+}
+
+uint32_t
+ModRoutingTable::GetNPairSearches (void) const
+{
+  return m_nPairSearches;
+}
+
+uint32_t
+ModRoutingTable::GetNAggregatedRows (void) const
+{
+  return m_aggregation.GetNCore ();
+}
+
+uint32_t
+ModRoutingTable::GetNRecontracted (void) const
+{
+  return m_contraction.GetNRecontracted ();
+}
+
+void
+ModRoutingTable::SampleStretch (void)
+{
+  uint32_t n = m_nodeTable.size ();
+  std::vector<uint32_t> pred (n);
+  std::vector<double> dist (n);
+  for (uint32_t s = 0; s < m_stretchSamples && n > 1; s++)
+    {
+      uint32_t i = m_stretchRng->GetInteger (0, n - 1);
+      uint32_t j = m_stretchRng->GetInteger (0, n - 1);
+      if (i == j || !IsReachable (i, j))
+        {
+          continue;
+        }
+      if (m_metric == EUCLIDEAN)
+        {
+          modcore::SingleSource<uint32_t, double, modcore::EuclideanMetric>::Run (m_graph, i, &pred[0], &dist[0]);
+        }
+      else
+        {
+          modcore::SingleSource<uint32_t, double, modcore::HopCountMetric>::Run (m_graph, i, &pred[0], &dist[0]);
+        }
+      m_stretchTrace (i, j, RouteLength (i, j) / dist[j]);
+    }
+}
+
+// Tree rooted at root for the lazy modes, computed on a cache miss.
+const ModRoutingTable::ShortestPathTree&
+ModRoutingTable::GetTree (uint32_t root)
+{
+  uint32_t slot = m_treeOf[root];
+  if (slot != NO_TREE)
+    {
+      m_lru.splice (m_lru.begin (), m_lru, m_lruPos[slot]);
+      return m_trees[slot];
+    }
+  if (m_trees.size () < m_treeCacheSize)
+    {
+      slot = m_trees.size ();
+      m_trees.push_back (ShortestPathTree ());
+      m_lru.push_front (slot);
+      m_lruPos.push_back (m_lru.begin ());
+    }
+  else
+    {
+      slot = m_lru.back ();
+      uint32_t old = m_trees[slot].root;
+      if (old < m_treeOf.size () && m_treeOf[old] == slot)
+        {
+          m_treeOf[old] = NO_TREE;
+        }
+      m_lru.splice (m_lru.begin (), m_lru, m_lruPos[slot]);
+    }
+  NS_LOG_LOGIC ("tree for " << root << " in slot " << slot);
+
+  // undirected links, so a destination tree is a source tree from the root
+  ShortestPathTree &tree = m_trees[slot];
+  uint32_t n = m_nodeTable.size ();
+  tree.root = root;
+  tree.pred.resize (n);
+  tree.dist.resize (n);
+  if (m_metric == EUCLIDEAN)
+    {
+      modcore::SingleSource<uint32_t, double, modcore::EuclideanMetric>::Run (m_graph, root, &tree.pred[0], &tree.dist[0]);
+    }
+  else
+    {
+      modcore::SingleSource<uint32_t, double, modcore::HopCountMetric>::Run (m_graph, root, &tree.pred[0], &tree.dist[0]);
+    }
+  m_treeOf[root] = slot;
+  return tree;
+}
+
+// First node after i on the path to j, for reachable i and j.
+uint32_t
+ModRoutingTable::FirstHop (uint32_t i, uint32_t j)
+{
+  if (m_mode == LAZY_DESTINATION)
+    {
+      return GetTree (j).pred[i];
+    }
+  if (m_mode == HIERARCHICAL)
+    {
+      return m_hierarchy.GetNextHop (i, j);
+    }
+  if (m_mode == GEOGRAPHIC)
+    {
+      modcore::GeoState<uint32_t> state;
+      return GeographicNextHop (i, j, state);
+    }
+  if (m_mode == ON_DEMAND)
+    {
+      return GetPairRoute (i, j).next;
+    }
+  if (m_mode == CONTRACTION)
+    {
+      uint32_t hop;
+      m_contraction.Query (i, j, &hop);
+      return hop;
+    }
+  if (m_mode == AGGREGATED)
+    {
+      return m_aggregation.GetFirstHop (i, j);
+    }
+  const uint32_t* pred = (m_mode == EAGER) ? m_modNext + (size_t) i * m_nodeTable.size () : &GetTree (i).pred[0];
+  uint32_t k = j;
+  while (pred[k] != i)
+    {
+      k = pred[k];
+    }
+  return k;
+}
+
+double
+ModRoutingTable::PathDistance (uint32_t i, uint32_t j)
+{
+  switch (m_mode)
+    {
+    case LAZY_SOURCE:
+      return GetTree (i).dist[j];
+    case LAZY_DESTINATION:
+      return GetTree (j).dist[i];
+    case HIERARCHICAL:
+      return RouteLength (i, j);
+    case GEOGRAPHIC:
+      return GeoLength (i, j, 0);
+    case ON_DEMAND:
+      return GetPairRoute (i, j).dist;
+    case CONTRACTION:
+      return m_contraction.Query (i, j, 0);
+    case AGGREGATED:
+      return m_aggregation.GetDistance (i, j);
+    default:
+      return m_modDist[(size_t) i * m_nodeTable.size () + j];
+    }
+}
+
+// Get direct-distance between two nodes
+double
+ModRoutingTable::GetDistance (Ipv4Address srcAddr, Ipv4Address dstAddr)
+{
+    uint32_t n = m_nodeTable.size(); // number of nodes
+    uint32_t i = GetIndex (srcAddr);
+    uint32_t j = GetIndex (dstAddr);
+    if (i >= n || j >= n || (m_mode == EAGER ? m_modDist == 0 : i >= m_treeOf.size () || j >= m_treeOf.size ()))
+      {
+        return HUGE_VAL;
+      }
+    
+    return PathDistance (i, j);
+}
+
+bool
+ModRoutingTable::IsReachable (Ipv4Address srcAddr, Ipv4Address dstAddr) const
+{
+  Ipv4Address relay;
+  return IsReachable (GetIndex (srcAddr), GetIndex (dstAddr)) || LookupStatic (srcAddr, dstAddr, relay);
+}
+
+bool
+ModRoutingTable::IsReachable (uint32_t i, uint32_t j) const
+{
+  return i < m_component.size () && j < m_component.size ()
+         && m_component[i] == m_component[j];
+}
+
+uint32_t
+ModRoutingTable::GetNPartitions (void) const
+{
+  return m_nComponents;
+}
+
+uint32_t
+ModRoutingTable::GetPartition (Ipv4Address addr) const
+{
+  return m_component.at (GetIndex (addr));
+}
+
+void
+ModRoutingTable::JoinGroup (Ipv4Address group, Ipv4Address member)
+{
+  NS_LOG_FUNCTION (group << member);
+  uint32_t i = GetIndex (member);
+  NS_ASSERT_MSG (i < m_nodeTable.size (), "JoinGroup before AddNode");
+  if (m_groups[group].insert (i).second)
+    {
+      DropMulticastTrees (group);
+    }
+}
+
+void
+ModRoutingTable::LeaveGroup (Ipv4Address group, Ipv4Address member)
+{
+  NS_LOG_FUNCTION (group << member);
+  std::map<Ipv4Address, std::set<uint32_t> >::iterator it = m_groups.find (group);
+  if (it != m_groups.end () && it->second.erase (GetIndex (member)) > 0)
+    {
+      DropMulticastTrees (group);
+    }
+}
+
+bool
+ModRoutingTable::IsGroupMember (Ipv4Address group, Ipv4Address addr) const
+{
+  std::map<Ipv4Address, std::set<uint32_t> >::const_iterator it = m_groups.find (group);
+  return it != m_groups.end () && it->second.count (GetIndex (addr)) > 0;
+}
+
+void
+ModRoutingTable::DropMulticastTrees (Ipv4Address group)
+{
+  m_multicastTrees.erase (m_multicastTrees.lower_bound (MulticastKey (group, 0)),
+                          m_multicastTrees.upper_bound (MulticastKey (group, std::numeric_limits<uint32_t>::max ())));
+}
+
+bool
+ModRoutingTable::GetMulticastHop (Ipv4Address source, Ipv4Address group, Ipv4Address node,
+                                  Ipv4Address &parent, std::vector<Ipv4Address> &children)
+{
+  const MulticastTree *tree = GetMulticastTree (GetIndex (source), group);
+  uint32_t k = GetIndex (node);
+  if (tree == 0)
+    {
+      return false;
+    }
+  std::vector<uint32_t>::const_iterator it = std::lower_bound (tree->node.begin (), tree->node.end (), k);
+  if (it == tree->node.end () || *it != k)
+    {
+      return false;
+    }
+  size_t pos = it - tree->node.begin ();
+  parent = m_nodeTable[tree->parent[pos]].addr;
+  children.clear ();
+  for (uint32_t c = tree->childStart[pos]; c < tree->childStart[pos + 1]; c++)
+    {
+      children.push_back (m_nodeTable[tree->child[c]].addr);
+    }
+  return true;
+}
+
+uint32_t
+ModRoutingTable::GetMulticastTreeSize (Ipv4Address source, Ipv4Address group)
+{
+  const MulticastTree *tree = GetMulticastTree (GetIndex (source), group);
+  return tree != 0 ? tree->node.size () - 1 : 0;
+}
+
+// Tree of (group, source), built on first use: members are grafted on by
+// their unicast path from the source, or in STEINER_TREE mode by the path
+// from the closest node already on the tree, closest member first.  0 if
+// there is no group, or no routes to build it from.
+const ModRoutingTable::MulticastTree*
+ModRoutingTable::GetMulticastTree (uint32_t source, Ipv4Address group)
+{
+  uint32_t n = m_nodeTable.size ();
+  std::map<Ipv4Address, std::set<uint32_t> >::const_iterator members = m_groups.find (group);
+  if (source >= n || members == m_groups.end () || m_mode == GEOGRAPHIC)
+    {
+      return 0;
+    }
+  MulticastKey key (group, source);
+  std::map<MulticastKey, MulticastTree>::iterator it = m_multicastTrees.find (key);
+  if (it != m_multicastTrees.end ())
+    {
+      return &it->second;
+    }
+
+  std::vector<uint32_t> pending;
+  for (std::set<uint32_t>::const_iterator m = members->second.begin (); m != members->second.end (); ++m)
+    {
+      if (*m != source && IsReachable (source, *m))
+        {
+          pending.push_back (*m);
+        }
+    }
+  std::vector<uint32_t> parent (n, n);
+  std::vector<uint32_t> added;
+  parent[source] = source;
+  if (m_multicastMode == SHORTEST_PATH_TREE)
+    {
+      for (size_t k = 0; k < pending.size (); k++)
+        {
+          Graft (source, pending[k], parent, added);
+        }
+    }
+  else
+    {
+      // distance from each pending member to the tree, and where it is
+      // closest; measured from the member's side, whose tree the lazy
+      // modes then keep for every node added
+      std::vector<double> gap (pending.size ());
+      std::vector<uint32_t> attach (pending.size (), source);
+      for (size_t k = 0; k < pending.size (); k++)
+        {
+          gap[k] = m_mode == LAZY_DESTINATION ? PathDistance (source, pending[k]) : PathDistance (pending[k], source);
+        }
+      while (!pending.empty ())
+        {
+          size_t best = std::min_element (gap.begin (), gap.end ()) - gap.begin ();
+          added.clear ();
+          Graft (attach[best], pending[best], parent, added);
+          pending[best] = pending.back ();
+          pending.pop_back ();
+          gap[best] = gap.back ();
+          gap.pop_back ();
+          attach[best] = attach.back ();
+          attach.pop_back ();
+          for (size_t a = 0; a < added.size (); a++)
+            {
+              for (size_t k = 0; k < pending.size (); k++)
+                {
+                  double d = m_mode == LAZY_DESTINATION ? PathDistance (added[a], pending[k]) : PathDistance (pending[k], added[a]);
+                  if (d < gap[k])
+                    {
+                      gap[k] = d;
+                      attach[k] = added[a];
+                    }
+                }
+            }
+        }
+    }
+
+  MulticastTree &tree = m_multicastTrees[key];
+  std::vector<std::vector<uint32_t> > children (n);
+  for (uint32_t v = 0; v < n; v++)
+    {
+      if (parent[v] < n && v != source)
+        {
+          children[parent[v]].push_back (v);
+        }
+    }
+  tree.childStart.push_back (0);
+  for (uint32_t v = 0; v < n; v++)
+    {
+      if (parent[v] < n)
+        {
+          tree.node.push_back (v);
+          tree.parent.push_back (parent[v]);
+          tree.child.insert (tree.child.end (), children[v].begin (), children[v].end ());
+          tree.childStart.push_back (tree.child.size ());
+        }
+    }
+  NS_LOG_LOGIC ("multicast tree " << m_nodeTable[source].addr << " -> " << group << ": "
+                << tree.node.size () - 1 << " links");
+  return &tree;
+}
+
+// Adds the path from the tree node "from" to member, starting at the last
+// node of the path already on the tree so that every node keeps one parent.
+void
+ModRoutingTable::Graft (uint32_t from, uint32_t member, std::vector<uint32_t> &parent, std::vector<uint32_t> &added)
+{
+  std::vector<uint32_t> path = GetPath (m_nodeTable[from].addr, m_nodeTable[member].addr);
+  size_t start = 0;
+  for (size_t h = 0; h < path.size (); h++)
+    {
+      if (parent[path[h]] < parent.size ())
+        {
+          from = path[h];
+          start = h + 1;
+        }
+    }
+  for (size_t h = start; h < path.size (); h++)
+    {
+      parent[path[h]] = from;
+      added.push_back (path[h]);
+      from = path[h];
+    }
+}
+
+void
+ModRoutingTable::NotifyNodeDown (Ipv4Address addr)
+{
+  NS_LOG_FUNCTION (addr);
+  uint32_t i = GetIndex (addr);
+  if (i < m_nodeTable.size ())
+    {
+      SetState (LinkKey (i, i), true);
+    }
+}
+
+void
+ModRoutingTable::NotifyNodeUp (Ipv4Address addr)
+{
+  NS_LOG_FUNCTION (addr);
+  uint32_t i = GetIndex (addr);
+  if (i < m_nodeTable.size ())
+    {
+      SetState (LinkKey (i, i), false);
+    }
+}
+
+void
+ModRoutingTable::NotifyLinkDown (Ipv4Address addr1, Ipv4Address addr2)
+{
+  NS_LOG_FUNCTION (addr1 << addr2);
+  uint32_t i = GetIndex (addr1);
+  uint32_t j = GetIndex (addr2);
+  if (i < m_nodeTable.size () && j < m_nodeTable.size () && i != j)
+    {
+      SetState (LinkKey (std::min (i, j), std::max (i, j)), true);
+    }
+}
+
+void
+ModRoutingTable::NotifyLinkUp (Ipv4Address addr1, Ipv4Address addr2)
+{
+  NS_LOG_FUNCTION (addr1 << addr2);
+  uint32_t i = GetIndex (addr1);
+  uint32_t j = GetIndex (addr2);
+  if (i < m_nodeTable.size () && j < m_nodeTable.size () && i != j)
+    {
+      SetState (LinkKey (std::min (i, j), std::max (i, j)), false);
+    }
+}
+
+// Applies an up/down event with flap dampening.  A recompute is requested
+// only when the usable state changes, so a suppressed element going up
+// and down again costs nothing.
+void
+ModRoutingTable::SetState (LinkKey key, bool down)
+{
+  std::map<LinkKey, LinkState>::iterator it = m_state.find (key);
+  if (it == m_state.end ())
+    {
+      LinkState fresh;
+      fresh.down = false;
+      fresh.suppressed = false;
+      fresh.penalty = 0;
+      fresh.updated = Simulator::Now ();
+      it = m_state.insert (std::make_pair (key, fresh)).first;
+    }
+  LinkState &state = it->second;
+  if (state.down == down)
+    {
+      return;
+    }
+  bool wasUsable = !state.down && !state.suppressed;
+  state.down = down;
+  DecayPenalty (state);
+  if (down && m_flapPenalty > 0)
+    {
+      state.penalty += m_flapPenalty;
+      if (!state.suppressed && state.penalty > m_suppressLimit)
+        {
+          NS_LOG_DEBUG ("suppressing " << key.first << "-" << key.second << " penalty " << state.penalty);
+          state.suppressed = true;
+        }
+      if (state.suppressed)
+        {
+          // penalty * 2^(-t / halfLife) reaches the reuse limit after t
+          double t = m_halfLife.GetSeconds () * std::log (state.penalty / m_reuseLimit) / std::log (2.0);
+          state.reuse.Cancel ();
+          state.reuse = Simulator::Schedule (Seconds (std::max (t, 0.0)), &ModRoutingTable::Reuse, this, key);
+        }
+    }
+  bool usable = !state.down && !state.suppressed;
+  if (wasUsable != usable && !SwitchFailureDiff (key, usable))
+    {
+      RequestUpdate ();
+    }
+}
+
+// With precomputed failures, a single failed link (and its repair) is
+// handled by swapping its diff in or out instead of a recompute.
+bool
+ModRoutingTable::SwitchFailureDiff (LinkKey key, bool usable)
+{
+  if (key.first == key.second || m_modNext == 0)
+    {
+      return false;
+    }
+  size_t link = m_failureDiffs.GetNLinks () > 0 ? m_failureDiffs.Find (key.first, key.second) : FailureDiffs::NONE;
+  if (link == FailureDiffs::NONE || (usable ? m_activeDiff != link : m_activeDiff != FailureDiffs::NONE))
+    {
+      return false;
+    }
+  NS_LOG_DEBUG ((usable ? "restoring " : "failing ") << key.first << "-" << key.second
+                << ", " << m_failureDiffs.GetNChanged (link) << " entries");
+  m_failureDiffs.Swap (link, m_modNext, m_modDist, m_component, m_nComponents);
+  m_activeDiff = usable ? FailureDiffs::NONE : link;
+  m_multicastTrees.clear ();
+  return true;
+}
+
+void
+ModRoutingTable::DecayPenalty (LinkState &state)
+{
+  Time now = Simulator::Now ();
+  if (state.penalty > 0 && m_halfLife.IsStrictlyPositive ())
+    {
+      state.penalty *= std::pow (0.5, (now - state.updated).GetSeconds () / m_halfLife.GetSeconds ());
+    }
+  state.updated = now;
+}
+
+void
+ModRoutingTable::Reuse (LinkKey key)
+{
+  LinkState &state = m_state[key];
+  DecayPenalty (state);
+  if (!state.suppressed || state.penalty > m_reuseLimit * 1.001)
+    {
+      return;
+    }
+  NS_LOG_DEBUG ("reusing " << key.first << "-" << key.second);
+  state.suppressed = false;
+  if (!state.down)
+    {
+      RequestUpdate ();
+    }
+}
+
+void
+ModRoutingTable::RequestUpdate (void)
+{
+  NS_LOG_FUNCTION (m_dirty);
+  m_nUpdateRequests++;
+  m_dirty = true;
+  if (!m_updateEvent.IsRunning ())
+    {
+      m_updateEvent = Simulator::Schedule (m_holdDown, &ModRoutingTable::ScheduledUpdate, this);
+    }
+}
+
+void
+ModRoutingTable::ScheduledUpdate (void)
+{
+  // an explicit UpdateRoute in the meantime already did the work
+  if (!m_dirty)
+    {
+      return;
+    }
+  m_nScheduledUpdates++;
+  UpdateRoute (m_txRange);
+}
+
+uint64_t
+ModRoutingTable::GeoCell (const Vector &p, int dx, int dy) const
+{
+  int64_t x = (int64_t) std::floor (p.x / m_txRange) + dx;
+  int64_t y = (int64_t) std::floor (p.y / m_txRange) + dy;
+  return ((uint64_t) (x + 0x80000000LL) << 32) | (uint32_t) (y + 0x80000000LL);
+}
+
+void
+ModRoutingTable::BuildGeoGrid (void)
+{
+  uint32_t n = m_nodeTable.size ();
+  m_geoCells.clear ();
+  m_geoCellOf.assign (n, 0);
+  m_geoSpeed = 0;
+  m_geoBuilt = Simulator::Now ();
+  if (m_txRange <= 0)
+    {
+      return;
+    }
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<MobilityModel> mobility = m_nodeTable[i].node->GetObject<MobilityModel> ();
+      Vector v = mobility->GetVelocity ();
+      m_geoSpeed = std::max (m_geoSpeed, std::sqrt (v.x * v.x + v.y * v.y + v.z * v.z));
+      m_geoCellOf[i] = GeoCell (mobility->GetPosition (), 0, 0);
+      m_geoCells[m_geoCellOf[i]].push_back (i);
+    }
+}
+
+// A node changed course: file it under its current cell, and make sure
+// the drift bound covers its new speed.
+void
+ModRoutingTable::MoveGeoCell (uint32_t i)
+{
+  if (i >= m_geoCellOf.size () || m_txRange <= 0)
+    {
+      return;
+    }
+  Ptr<MobilityModel> mobility = m_nodeTable[i].node->GetObject<MobilityModel> ();
+  Vector v = mobility->GetVelocity ();
+  m_geoSpeed = std::max (m_geoSpeed, std::sqrt (v.x * v.x + v.y * v.y + v.z * v.z));
+  uint64_t cell = GeoCell (mobility->GetPosition (), 0, 0);
+  if (cell == m_geoCellOf[i])
+    {
+      return;
+    }
+  std::vector<uint32_t> &old = m_geoCells[m_geoCellOf[i]];
+  old.erase (std::find (old.begin (), old.end (), i));
+  m_geoCells[cell].push_back (i);
+  m_geoCellOf[i] = cell;
+}
+
+uint32_t
+ModRoutingTable::GeographicNextHop (uint32_t i, uint32_t j, modcore::GeoState<uint32_t> &state)
+{
+  uint32_t n = m_nodeTable.size ();
+  if (i >= n || j >= n || i == j)
+    {
+      return i;
+    }
+  if (m_geoCellOf.size () != n)
+    {
+      BuildGeoGrid ();
+    }
+  // cells hold where nodes were; search wide enough for how far they may
+  // have gone, and start over once that is more than a cell
+  double drift = m_geoSpeed * (Simulator::Now () - m_geoBuilt).GetSeconds ();
+  if (drift > m_txRange)
+    {
+      BuildGeoGrid ();
+      drift = 0;
+    }
+  int reach = drift > 0 ? 2 : 1;
+
+  Vector at = m_nodeTable[i].node->GetObject<MobilityModel> ()->GetPosition ();
+  Vector to = m_nodeTable[j].node->GetObject<MobilityModel> ()->GetPosition ();
+  std::vector<modcore::GreedyPerimeter<uint32_t>::Neighbor> nbrs;
+  for (int dx = -reach; dx <= reach; dx++)
+    {
+      for (int dy = -reach; dy <= reach; dy++)
+        {
+          std::map<uint64_t, std::vector<uint32_t> >::const_iterator cell = m_geoCells.find (GeoCell (at, dx, dy));
+          if (cell == m_geoCells.end ())
+            {
+              continue;
+            }
+          for (std::vector<uint32_t>::const_iterator k = cell->second.begin (); k != cell->second.end (); ++k)
+            {
+              if (*k == i || IsDown (i, *k) || IsDown (*k, *k))
+                {
+                  continue;
+                }
+              Vector p = m_nodeTable[*k].node->GetObject<MobilityModel> ()->GetPosition ();
+              if (CalculateDistance (at, p) <= m_txRange)
+                {
+                  nbrs.push_back (std::make_pair (*k, modcore::Point (p.x, p.y, p.z)));
+                }
+            }
+        }
+    }
+  return modcore::GreedyPerimeter<uint32_t>::NextHop (i, modcore::Point (at.x, at.y, at.z), j,
+                                                     modcore::Point (to.x, to.y, to.z), nbrs, state);
+}
+
+Ipv4Address
+ModRoutingTable::LookupRoute (Ipv4Address srcAddr, Ipv4Address dstAddr, modcore::GeoState<uint32_t> &state)
+{
+  Ipv4Address relay;
+  if (LookupStatic (srcAddr, dstAddr, relay))
+    {
+      return relay;
+    }
+  uint32_t i = GetIndex (srcAddr);
+  uint32_t k = GeographicNextHop (i, GetIndex (dstAddr), state);
+  return k != i ? m_nodeTable[k].addr : srcAddr;
+}
+
+// Walks the geographic route from i to j at the current positions; its
+// length, or HUGE_VAL if the packet would be dropped.
+double
+ModRoutingTable::GeoLength (uint32_t i, uint32_t j, std::vector<uint32_t> *path)
+{
+  modcore::GeoState<uint32_t> state;
+  double length = 0;
+  // a face walk visits each link at most twice
+  uint32_t limit = 4 * m_nodeTable.size ();
+  for (uint32_t k = i; k != j; )
+    {
+      uint32_t next = GeographicNextHop (k, j, state);
+      if (next == k || limit-- == 0)
+        {
+          return HUGE_VAL;
+        }
+      length += (m_metric == EUCLIDEAN) ? DistFromTable (k, next) : 1;
+      if (path != 0)
+        {
+          path->push_back (next);
+        }
+      k = next;
+    }
+  return length;
+}
+
+ModRoutingTable::Mode
+ModRoutingTable::GetMode (void) const
+{
+  return m_mode;
+}
+
+void
+ModRoutingTable::CourseChanged (Ptr<const MobilityModel> model)
+{
+  std::map<Ptr<const MobilityModel>, uint32_t>::const_iterator it = m_mobilityIndex.find (model);
+  if (it == m_mobilityIndex.end ())
+    {
+      return;
+    }
+  if (m_mode == GEOGRAPHIC)
+    {
+      MoveGeoCell (it->second);
+    }
+  if (!m_kinetic || m_kineticRange <= 0)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (it->second);
+  PredictCrossings (it->second);
+  ScheduleCrossing ();
+}
+
+void
+ModRoutingTable::PredictCrossings (uint32_t i)
+{
+  uint32_t n = std::min<size_t> (m_nodeTable.size (), m_component.size ());
+  for (uint32_t j = 0; j < n; j++)
+    {
+      if (j != i)
+        {
+          PredictCrossing (std::min (i, j), std::max (i, j));
+        }
+    }
+}
+
+// Solves |dp + dv t| = txRange for the first t in the future, dp and dv
+// being the relative position and velocity of j seen from i.
+void
+ModRoutingTable::PredictCrossing (uint32_t i, uint32_t j)
+{
+  LinkKey key (i, j);
+  std::map<LinkKey, std::multimap<Time, LinkKey>::iterator>::iterator old = m_crossingOf.find (key);
+  if (old != m_crossingOf.end ())
+    {
+      m_crossings.erase (old->second);
+      m_crossingOf.erase (old);
+    }
+
+  Ptr<MobilityModel> mi = m_nodeTable[i].node->GetObject<MobilityModel> ();
+  Ptr<MobilityModel> mj = m_nodeTable[j].node->GetObject<MobilityModel> ();
+  Vector pi = mi->GetPosition (), pj = mj->GetPosition ();
+  Vector vi = mi->GetVelocity (), vj = mj->GetVelocity ();
+  double px = pj.x - pi.x, py = pj.y - pi.y, pz = pj.z - pi.z;
+  double vx = vj.x - vi.x, vy = vj.y - vi.y, vz = vj.z - vi.z;
+  double a = vx * vx + vy * vy + vz * vz;
+  double b = 2 * (px * vx + py * vy + pz * vz);
+  double c = px * px + py * py + pz * pz - m_txRange * m_txRange;
+  double disc = b * b - 4 * a * c;
+  if (a <= 0 || disc < 0)
+    {
+      return;
+    }
+  // skip the crossing being handled right now
+  const double epsilon = 1e-6;
+  double root = std::sqrt (disc);
+  double t = (-b - root) / (2 * a);
+  if (t <= epsilon)
+    {
+      t = (-b + root) / (2 * a);
+    }
+  if (t <= epsilon)
+    {
+      return;
+    }
+  m_crossingOf[key] = m_crossings.insert (std::make_pair (Simulator::Now () + Seconds (t), key));
+}
+
+void
+ModRoutingTable::ScheduleCrossing (void)
+{
+  m_crossingEvent.Cancel ();
+  if (!m_crossings.empty ())
+    {
+      m_crossingEvent = Simulator::Schedule (m_crossings.begin ()->first - Simulator::Now (),
+                                             &ModRoutingTable::Crossing, this);
+    }
+}
+
+// Pairs due now entered or left each other's range: predict their next
+// crossing and have the routes repaired through RequestUpdate.
+void
+ModRoutingTable::Crossing (void)
+{
+  Time now = Simulator::Now ();
+  bool changed = false;
+  while (!m_crossings.empty () && m_crossings.begin ()->first <= now)
+    {
+      LinkKey key = m_crossings.begin ()->second;
+      NS_LOG_LOGIC ("pair " << key.first << "-" << key.second << " crosses txRange");
+      m_nCrossings++;
+      changed = true;
+      PredictCrossing (key.first, key.second);
+    }
+  if (changed)
+    {
+      RequestUpdate ();
+    }
+  ScheduleCrossing ();
+}
+
+uint32_t
+ModRoutingTable::GetNCrossings (void) const
+{
+  return m_nCrossings;
+}
+
+uint32_t
+ModRoutingTable::GetNUpdateRequests (void) const
+{
+  return m_nUpdateRequests;
+}
+
+uint32_t
+ModRoutingTable::GetNScheduledUpdates (void) const
+{
+  return m_nScheduledUpdates;
+}
+
+void
+ModRoutingTable::SetTrajectory (Ipv4Address addr, const std::vector<Waypoint> &waypoints)
+{
+  NS_LOG_FUNCTION (addr << waypoints.size ());
+  uint32_t i = GetIndex (addr);
+  NS_ASSERT_MSG (i < m_nodeTable.size (), "SetTrajectory before AddNode");
+  if (m_trajectory.size () <= i)
+    {
+      m_trajectory.resize (i + 1);
+    }
+  m_trajectory[i] = modcore::Trajectory ();
+  for (size_t k = 0; k < waypoints.size (); k++)
+    {
+      const Vector &p = waypoints[k].position;
+      m_trajectory[i].Add (waypoints[k].time.GetSeconds (), modcore::Point (p.x, p.y, p.z));
+    }
+}
+
+bool
+ModRoutingTable::LoadNs2Trace (const std::string &filename)
+{
+  NS_LOG_FUNCTION (filename);
+  std::ifstream in (filename.c_str ());
+  if (!in.is_open ())
+    {
+      NS_LOG_ERROR ("Cannot open " << filename);
+      return false;
+    }
+  uint32_t n = m_nodeTable.size ();
+  std::map<uint32_t, uint32_t> byId;
+  std::vector<modcore::Point> start (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      byId[m_nodeTable[i].node->GetId ()] = i;
+      Vector v = m_nodeTable[i].node->GetObject<MobilityModel> ()->GetPosition ();
+      start[i] = modcore::Point (v.x, v.y, v.z);
+    }
+
+  struct Move
+  {
+    double t;
+    uint32_t node;
+    double x, y, speed;
+    bool operator< (const Move &o) const
+    {
+      return t < o.t;
+    }
+  };
+  std::vector<Move> moves;
+  std::string line;
+  while (std::getline (in, line))
+    {
+      int id;
+      char axis;
+      double v;
+      Move m;
+      if (sscanf (line.c_str (), " $node_(%d) set %c_ %lf", &id, &axis, &v) == 3)
+        {
+          std::map<uint32_t, uint32_t>::const_iterator it = byId.find (id);
+          if (it != byId.end ())
+            {
+              modcore::Point &p = start[it->second];
+              (axis == 'X' ? p.x : axis == 'Y' ? p.y : p.z) = v;
+            }
+        }
+      else if (sscanf (line.c_str (), " $ns_ at %lf \"$node_(%d) setdest %lf %lf %lf",
+                       &m.t, &id, &m.x, &m.y, &m.speed) == 5)
+        {
+          std::map<uint32_t, uint32_t>::const_iterator it = byId.find (id);
+          if (it != byId.end ())
+            {
+              m.node = it->second;
+              moves.push_back (m);
+            }
+        }
+    }
+  std::stable_sort (moves.begin (), moves.end ());
+
+  m_trajectory.assign (n, modcore::Trajectory ());
+  for (uint32_t i = 0; i < n; i++)
+    {
+      m_trajectory[i].Add (0, start[i]);
+    }
+  for (size_t k = 0; k < moves.size (); k++)
+    {
+      modcore::Trajectory &tr = m_trajectory[moves[k].node];
+      double z = tr.GetPosition (moves[k].t).z;
+      tr.MoveTo (moves[k].t, modcore::Point (moves[k].x, moves[k].y, z), moves[k].speed);
+    }
+  NS_LOG_INFO (moves.size () << " setdest commands for " << n << " nodes");
+  return true;
+}
+
+void
+ModRoutingTable::PrecomputeTimeline (double txRange, Time stop)
+{
+  NS_LOG_FUNCTION (txRange << stop);
+  NS_ASSERT_MSG (m_mode == EAGER && !m_wired, "PrecomputeTimeline needs Eager mode and wireless nodes");
+  UpdateRoute (txRange);
+
+  uint32_t n = m_nodeTable.size ();
+  double now = Simulator::Now ().GetSeconds ();
+  std::vector<modcore::Trajectory> traj (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      if (i < m_trajectory.size () && !m_trajectory[i].GetTimes ().empty ())
+        {
+          traj[i] = m_trajectory[i];
+        }
+      else
+        {
+          Vector v = m_nodeTable[i].node->GetObject<MobilityModel> ()->GetPosition ();
+          traj[i].Add (now, modcore::Point (v.x, v.y, v.z));
+        }
+    }
+
+  // every topology change is some pair crossing txRange
+  unsigned threads = m_precomputeThreads > 0 ? m_precomputeThreads : std::thread::hardware_concurrency ();
+  std::vector<double> times (1, now);
+  modcore::AllRangeCrossings (traj, txRange, now, stop.GetSeconds (), threads, times);
+  std::sort (times.begin (), times.end ());
+  times.erase (std::unique (times.begin (), times.end ()), times.end ());
+
+  if (m_metric == EUCLIDEAN)
+    {
+      m_timeline.Build<modcore::EuclideanMetric> (traj, txRange, times, stop.GetSeconds (), threads);
+    }
+  else
+    {
+      m_timeline.Build<modcore::HopCountMetric> (traj, txRange, times, stop.GetSeconds (), threads);
+    }
+  NS_LOG_INFO (times.size () << " crossings, " << m_timeline.GetNSteps () << " distinct topologies, "
+               << m_timeline.GetBytes () << " bytes");
+
+  m_timeline.GetInitial (m_modNext, m_modDist, m_component, m_nComponents);
+  m_failureDiffs.Clear ();
+  m_timelineStep = 0;
+  ScheduleTimelineStep ();
+}
+
+uint32_t
+ModRoutingTable::GetNTimelineSteps (void) const
+{
+  return m_timeline.GetNSteps ();
+}
+
+void
+ModRoutingTable::ScheduleTimelineStep (void)
+{
+  if (m_timelineStep + 1 < m_timeline.GetNSteps ())
+    {
+      Time at = Seconds (m_timeline.GetTime (m_timelineStep + 1));
+      m_timelineEvent = Simulator::Schedule (std::max (at - Simulator::Now (), Seconds (0)),
+                                             &ModRoutingTable::TimelineStep, this);
+    }
+}
+
+void
+ModRoutingTable::TimelineStep (void)
+{
+  m_timelineStep++;
+  NS_LOG_LOGIC ("timeline step " << m_timelineStep);
+  m_timeline.Apply (m_timelineStep, m_modNext, m_modDist, m_component, m_nComponents);
+  m_multicastTrees.clear ();
+  ScheduleTimelineStep ();
+}
+
+bool
+ModRoutingTable::IsDown (uint32_t i, uint32_t j) const
+{
+  std::map<LinkKey, LinkState>::const_iterator it = m_state.find (LinkKey (std::min (i, j), std::max (i, j)));
+  return it != m_state.end () && (it->second.down || it->second.suppressed);
+}
+
+const modcore::Graph<uint32_t, double>&
+ModRoutingTable::GetGraph (void) const
+{
+  return m_graph;
+}
+
+modcore::NextHopStore<uint32_t, double>
+ModRoutingTable::GetNextHopStore (void) const
+{
+  return modcore::NextHopStore<uint32_t, double> (m_graph.GetN (), m_modNext, m_modDist);
+}
+
+ModRoutingTable::Metric
+ModRoutingTable::GetMetric (void) const
+{
+  return m_metric;
+}
+
+ModRoutingTable::Algorithm
+ModRoutingTable::GetAlgorithm (void) const
+{
+  return m_lastAlgorithm;
+}
+
+uint64_t
+ModRoutingTable::GetMemoryUsage (void) const
+{
+  uint64_t bytes = m_nextBuffer.GetBytes () + m_distBuffer.GetBytes () + m_graph.GetBytes ()
+    + m_failureDiffs.GetBytes () + m_timeline.GetBytes () + m_hierarchy.GetBytes () + m_contraction.GetBytes ()
+    + m_aggregation.GetBytes ()
+    + m_graphPos.capacity () * sizeof (modcore::Point)
+    + m_pairRoutes.size () * (sizeof (std::pair<const uint64_t, PairRoute>) + 4 * sizeof (void *))
+    + m_pairLru.size () * (sizeof (uint64_t) + 2 * sizeof (void *))
+    + m_component.capacity () * sizeof (uint32_t) + m_staticRoutes.GetBytes ();
+  for (std::map<Ipv4Address, modcore::PrefixTable<Ipv4Address> >::const_iterator it = m_scopedRoutes.begin ();
+       it != m_scopedRoutes.end (); ++it)
+    {
+      bytes += it->second.GetBytes ();
+    }
+  for (std::vector<ShortestPathTree>::const_iterator t = m_trees.begin (); t != m_trees.end (); ++t)
+    {
+      bytes += t->pred.capacity () * sizeof (uint32_t) + t->dist.capacity () * sizeof (double);
+    }
+  return bytes + m_trees.capacity () * sizeof (ShortestPathTree) + m_treeOf.capacity () * sizeof (uint32_t);
+}
+
+uint32_t
+ModRoutingTable::GetIndex (Ipv4Address addr) const
+{
+  std::map<Ipv4Address, uint32_t>::const_iterator it = m_addrIndex.find (addr);
+  if (it == m_addrIndex.end ())
+    {
+      return m_nodeTable.size ();
+    }
+  return it->second;
+}
+
+bool
+ModRoutingTable::IsLinked (uint32_t i, uint32_t j)
+{
+  if (IsDown (i, i) || IsDown (j, j) || IsDown (i, j))
+    {
+      return false;
+    }
+  if (m_wired)
+    {
+      return m_links.count (std::make_pair (std::min (i, j), std::max (i, j))) > 0;
+    }
+  double distance = DistFromTable (i, j);
+  return distance > 0 && distance <= m_txRange;
+}
+
+double 
+ModRoutingTable::DistFromTable (uint32_t i, uint32_t j)
+{
+  Vector pos1, pos2;
   ModNodeEntry se;
   double dist;
   
@@ -256,7 +2122,22 @@ void
 ModRoutingTable::Print (Ptr<OutputStreamWrapper> stream) const
 {
   NS_LOG_FUNCTION ("");
-  // not implemented
+  std::ostream* os = stream->GetStream ();
+  *os << " partitions: " << m_nComponents << std::endl;
+  for (uint32_t c = 0; c < m_nComponents; c++)
+    {
+      uint32_t size = 0;
+      *os << "  [" << c << "]";
+      for (uint32_t i = 0; i < m_component.size (); i++)
+        {
+          if (m_component[i] == c)
+            {
+              *os << " " << m_nodeTable[i].addr;
+              size++;
+            }
+        }
+      *os << " (" << size << " nodes)" << std::endl;
+    }
 }
 
 } // namemodace ns3
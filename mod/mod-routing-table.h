@@ -24,33 +24,204 @@
 #include "ns3/node.h"
 #include "ns3/ipv4-route.h"
 #include "ns3/output-stream-wrapper.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/waypoint.h"
+#include "ns3/traced-callback.h"
+#include "ns3/random-variable-stream.h"
+#include "mod-routing-core.h"
 #include <list>
+#include <map>
+#include <set>
+#include <string>
 #include <vector>
 
 namespace ns3 {
 
+class MobilityModel;
+
 class ModRoutingTable : public Object
 {
 public:
+  enum Metric
+  {
+    HOP_COUNT,
+    EUCLIDEAN
+  };
+  // EAGER fills the n x n matrices in UpdateRoute; the lazy modes build one
+  // shortest-path tree per source (or per destination) on first lookup and
+  // keep up to TreeCacheSize of them, least recently used evicted first.
+  // HIERARCHICAL clusters nodes by grid cell (or BFS ball when wired) and
+  // keeps tables only within clusters and between clusters, about
+  // n sqrt (n) memory for routes that are no longer shortest.  GEOGRAPHIC
+  // keeps no routes at all: each hop picks from the nodes in range at their
+  // current positions (see GeographicNextHop).  ON_DEMAND runs an A*
+  // search per (source, destination) pair on first lookup and remembers the
+  // next hop of every node on the path found, until the topology changes
+  // (up to PairCacheSize of them, least recently used evicted first).
+  // CONTRACTION keeps a contraction hierarchy, about linear memory, and
+  // answers each lookup exactly with two small upward searches; an
+  // UpdateRoute that only adds links re-contracts part of it.  AGGREGATED
+  // fills the matrices only for nodes that can relay; a leaf such as a host
+  // on its access switch shares that switch's row and column, so memory and
+  // build time follow the number of switches, with routes still exact.
+  enum Mode
+  {
+    EAGER,
+    LAZY_SOURCE,
+    LAZY_DESTINATION,
+    HIERARCHICAL,
+    GEOGRAPHIC,
+    ON_DEMAND,
+    CONTRACTION,
+    AGGREGATED
+  };
+  // hop-count all pairs in Eager mode: one BFS per source, or bit-parallel
+  // multi-source BFS; AUTO picks by node count and average degree
+  enum Algorithm
+  {
+    AUTO,
+    BFS,
+    MULTI_SOURCE_BFS
+  };
+  // multicast tree from a source to a group's members: the union of the
+  // shortest paths, or members grafted nearest to the tree first (a
+  // Steiner tree approximation), which shares more links at the price of
+  // longer paths to some members
+  enum MulticastMode
+  {
+    SHORTEST_PATH_TREE,
+    STEINER_TREE
+  };
+
+  // stretch of one sampled route in HIERARCHICAL mode: its length over
+  // the shortest path length
+  typedef void (* StretchCallback)(uint32_t src, uint32_t dst, double stretch);
 
   ModRoutingTable ();
   virtual ~ModRoutingTable ();
 
   static TypeId GetTypeId ();
+  // Static routes, matched on the longest destination prefix ahead of the
+  // computed routes by LookupRoute (and IsReachable, so destinations
+  // outside the table can be reached through them).  The source is the
+  // node looking the route up, as in LookupRoute: a route with one applies
+  // at that node only and wins over any route without one, while source
+  // 0.0.0.0 applies everywhere.  Without a mask the route is a host route.
+  // Each lookup takes a few reads however many routes there are.
   void AddRoute (Ipv4Address srcAddr, Ipv4Address relayAddr, Ipv4Address dstAddr);
+  void AddRoute (Ipv4Address srcAddr, Ipv4Address relayAddr, Ipv4Address dstAddr, Ipv4Mask dstMask);
+  void RemoveRoute (Ipv4Address srcAddr, Ipv4Address dstAddr, Ipv4Mask dstMask);
+  uint32_t GetNStaticRoutes (void) const;
+  // the static route LookupRoute would take for the pair, if any
+  bool LookupStatic (Ipv4Address srcAddr, Ipv4Address dstAddr, Ipv4Address &relay) const;
   void AddNode (Ptr<Node> node, Ipv4Address addr);
+  void AddLink (Ipv4Address addr1, Ipv4Address addr2);
+  void RemoveLink (Ipv4Address addr1, Ipv4Address addr2);
   Ipv4Address LookupRoute (Ipv4Address srcAddr, Ipv4Address dstAddr);
   void UpdateRoute (double txRange);
   double GetDistance (Ipv4Address srcAddr, Ipv4Address dstAddr);
+  // Bulk versions of LookupRoute/GetDistance for count (src, dst) pairs,
+  // by address or by dense node index.  Results go to the caller's buffers;
+  // either output may be null.  Unreachable pairs get the source as relay
+  // and HUGE_VAL as distance.
+  void LookupRouteBatch (const Ipv4Address* srcAddr, const Ipv4Address* dstAddr, uint32_t count,
+                         Ipv4Address* relayAddr, double* distance);
+  void LookupRouteBatch (const uint32_t* src, const uint32_t* dst, uint32_t count,
+                         uint32_t* relay, double* distance);
+  std::vector<uint32_t> GetPath (Ipv4Address srcAddr, Ipv4Address dstAddr);
+  // GEOGRAPHIC mode: next hop from i for a packet to j, greedy or along a
+  // face (GPSR), with the packet's state updated in place.  i itself when
+  // there is none.  Cost grows with the number of nodes in range, and
+  // partitions are not known, so every pair counts as reachable.
+  uint32_t GeographicNextHop (uint32_t i, uint32_t j, modcore::GeoState<uint32_t> &state);
+  Ipv4Address LookupRoute (Ipv4Address srcAddr, Ipv4Address dstAddr, modcore::GeoState<uint32_t> &state);
+  Mode GetMode (void) const;
+  Ipv4Address GetAddress (uint32_t index) const;
+  // node registered with addr, 0 if none
+  Ptr<Node> GetNode (Ipv4Address addr) const;
+  uint32_t GetNNodes (void) const;
+
+  // Topology events.  A down node or link is left out of the graph; each
+  // event asks for a recompute (see RequestUpdate).  A node or link that
+  // keeps flapping is held down until its penalty decays (dampening).
+  void NotifyNodeDown (Ipv4Address addr);
+  void NotifyNodeUp (Ipv4Address addr);
+  void NotifyLinkDown (Ipv4Address addr1, Ipv4Address addr2);
+  void NotifyLinkUp (Ipv4Address addr1, Ipv4Address addr2);
+  // Marks the table dirty; all requests within HoldDown of the first one
+  // are served by a single UpdateRoute with the last txRange.
+  void RequestUpdate (void);
+  uint32_t GetNUpdateRequests (void) const;
+  // range crossings handled in Kinetic mode
+  uint32_t GetNCrossings (void) const;
+  uint32_t GetNScheduledUpdates (void) const;
+  // searches run in ON_DEMAND mode
+  uint32_t GetNPairSearches (void) const;
+  // nodes contracted by the last UpdateRoute in CONTRACTION mode
+  uint32_t GetNRecontracted (void) const;
+  // nodes with their own row and column in AGGREGATED mode
+  uint32_t GetNAggregatedRows (void) const;
+
+  // Deterministic mobility.  With every node's trajectory known up front
+  // (nodes without one stay where they are), PrecomputeTimeline builds the
+  // routes of each topology the nodes pass through until stop, in parallel
+  // (PrecomputeThreads), and installs each as a delta at the exact time it
+  // starts, so the simulation itself computes no routes.  Eager mode and
+  // wireless nodes only; an UpdateRoute drops the rest of the timeline.
+  void SetTrajectory (Ipv4Address addr, const std::vector<Waypoint> &waypoints);
+  // ns-2 movement file ("set X_" and "setdest" lines); $node_(i) is the
+  // registered node whose Node::GetId () is i
+  bool LoadNs2Trace (const std::string &filename);
+  void PrecomputeTimeline (double txRange, Time stop);
+  uint32_t GetNTimelineSteps (void) const;
+
+  // Multicast groups.  Packets from a source to a group follow a tree
+  // rooted at the source that reaches every member in its partition.  Trees
+  // are built from the unicast routes on first use and kept until the next
+  // UpdateRoute or change to the group; GEOGRAPHIC mode keeps no routes and
+  // so has none.
+  void JoinGroup (Ipv4Address group, Ipv4Address member);
+  void LeaveGroup (Ipv4Address group, Ipv4Address member);
+  bool IsGroupMember (Ipv4Address group, Ipv4Address addr) const;
+  // Where node is on the tree of (source, group): the node it gets the
+  // packets from (itself at the source) and the nodes it sends them on to.
+  // False when it is not on the tree.
+  bool GetMulticastHop (Ipv4Address source, Ipv4Address group, Ipv4Address node,
+                        Ipv4Address &parent, std::vector<Ipv4Address> &children);
+  // links of the tree, each crossed once per packet
+  uint32_t GetMulticastTreeSize (Ipv4Address source, Ipv4Address group);
+
+  // reachability index, rebuilt by UpdateRoute
+  bool IsReachable (Ipv4Address srcAddr, Ipv4Address dstAddr) const;
+  uint32_t GetNPartitions (void) const;
+  uint32_t GetPartition (Ipv4Address addr) const;
+
+  // Read-only views for offline tools, valid until the next UpdateRoute.
+  // The next-hop store is empty (null matrices) unless Mode is EAGER.
+  const modcore::Graph<uint32_t, double>& GetGraph (void) const;
+  modcore::NextHopStore<uint32_t, double> GetNextHopStore (void) const;
+  Metric GetMetric (void) const;
+  // engine the last hop-count UpdateRoute used
+  Algorithm GetAlgorithm (void) const;
+
+  // bytes held by the path matrices, the graph, the partition index and
+  // the static routes
+  uint64_t GetMemoryUsage (void) const;
 
   void Print (Ptr<OutputStreamWrapper> stream) const;
   std::vector<Ipv4Address> findListOfAttachedRelays(Ipv4Address currentNode);
+
+protected:
+  virtual void DoDispose (void);
+
 private:
   typedef struct
     {
       Ipv4Address srcAddr;
       Ipv4Address relayAddr;
       Ipv4Address dstAddr;
+      Ipv4Mask dstMask;
     }
   ModtableEntry;
   
@@ -60,16 +231,172 @@ private:
       Ipv4Address addr;
     } 
   ModNodeEntry;
+
+  // up/down state and flap penalty of a node (key i, i) or link (key i < j)
+  struct LinkState
+  {
+    bool down;
+    bool suppressed;
+    double penalty;
+    Time updated;
+    EventId reuse;
+  };
+  typedef std::pair<uint32_t, uint32_t> LinkKey;
+  typedef modcore::LinkFailureDiffs<uint32_t, double> FailureDiffs;
+  typedef modcore::RouteTimeline<uint32_t, double> Timeline;
+
+  // ON_DEMAND memo: next hop and remaining length towards a destination
+  struct PairRoute
+  {
+    uint32_t next;
+    double dist;
+    std::list<uint64_t>::iterator lru;
+  };
+
+  // shortest-path tree rooted at one node; for a destination tree pred[v]
+  // is the next hop from v towards the root
+  struct ShortestPathTree
+  {
+    uint32_t root;
+    std::vector<uint32_t> pred;
+    std::vector<double> dist;
+  };
+
+  // multicast tree of one (group, source): the nodes on it in index order,
+  // with the parent of each and its children at child[childStart[k]..]
+  struct MulticastTree
+  {
+    std::vector<uint32_t> node;
+    std::vector<uint32_t> parent;
+    std::vector<uint32_t> childStart;
+    std::vector<uint32_t> child;
+  };
+  typedef std::pair<Ipv4Address, uint32_t> MulticastKey;
   
-  double DistFromTable (uint16_t i, uint16_t j);
+  uint32_t GetIndex (Ipv4Address addr) const;
+  void InsertStatic (const ModtableEntry &se);
+  bool IsReachable (uint32_t i, uint32_t j) const;
+  void BuildGraph (void);
+  template <typename Builder>
+  void ExcludeDown (Builder &builder) const;
+  void SetState (LinkKey key, bool down);
+  void DecayPenalty (LinkState &state);
+  void Reuse (LinkKey key);
+  bool SwitchFailureDiff (LinkKey key, bool usable);
+  size_t ClusterKeys (std::vector<uint32_t> &key) const;
+  void SampleStretch (void);
+  double RouteLength (uint32_t i, uint32_t j);
+  double LinkWeight (uint32_t i, uint32_t j) const;
+  const PairRoute& GetPairRoute (uint32_t i, uint32_t j);
+  const PairRoute& MemoPairRoute (uint64_t key, uint32_t next, double dist);
+  void BuildGeoGrid (void);
+  void MoveGeoCell (uint32_t i);
+  uint64_t GeoCell (const Vector &p, int dx, int dy) const;
+  double GeoLength (uint32_t i, uint32_t j, std::vector<uint32_t> *path);
+  void CourseChanged (Ptr<const MobilityModel> model);
+  void PredictCrossings (uint32_t i);
+  void PredictCrossing (uint32_t i, uint32_t j);
+  void ScheduleCrossing (void);
+  void Crossing (void);
+  void TimelineStep (void);
+  void ScheduleTimelineStep (void);
+  void ScheduledUpdate (void);
+  bool IsDown (uint32_t i, uint32_t j) const;
+  const ShortestPathTree& GetTree (uint32_t root);
+  uint32_t FirstHop (uint32_t i, uint32_t j);
+  double PathDistance (uint32_t i, uint32_t j);
+  double DistFromTable (uint32_t i, uint32_t j);
+  bool IsLinked (uint32_t i, uint32_t j);
+  const MulticastTree* GetMulticastTree (uint32_t source, Ipv4Address group);
+  void Graft (uint32_t from, uint32_t member, std::vector<uint32_t> &parent, std::vector<uint32_t> &added);
+  void DropMulticastTrees (Ipv4Address group);
   
   std::list<ModtableEntry> m_modtable;
+  // static routes by destination prefix: unscoped, and per source
+  modcore::PrefixTable<Ipv4Address> m_staticRoutes;
+  std::map<Ipv4Address, modcore::PrefixTable<Ipv4Address> > m_scopedRoutes;
   std::vector<ModNodeEntry> m_nodeTable;
+  std::map<Ipv4Address, uint32_t> m_addrIndex;
+  std::set<std::pair<uint32_t, uint32_t> > m_links;
+  bool m_wired; // adjacency from m_links rather than txRange
   
-  uint16_t* m_modNext;
+  // path matrices, reused by UpdateRoute while n does not grow;
+  // m_modNext/m_modDist point into them once routes are built
+  modcore::MatrixBuffer<uint32_t> m_nextBuffer;
+  modcore::MatrixBuffer<double> m_distBuffer;
+  uint32_t* m_modNext;
   double*   m_modDist;
+  bool      m_hugePages;
   
   double    m_txRange;
+  Metric    m_metric;
+  Mode      m_mode;
+  Algorithm m_algorithm;
+  Algorithm m_lastAlgorithm;
+  uint32_t  m_treeCacheSize;
+  // lazy mode tree cache: slot of each root (or NO_TREE), slots in LRU order
+  std::vector<ShortestPathTree> m_trees;
+  std::vector<uint32_t> m_treeOf;
+  std::list<uint32_t> m_lru;
+  std::vector<std::list<uint32_t>::iterator> m_lruPos;
+  modcore::Graph<uint32_t, double> m_graph;
+  std::vector<modcore::Point> m_graphPos; // positions m_graph was built from
+  modcore::PairSearch<uint32_t, double> m_pairSearch;
+  std::map<uint64_t, PairRoute> m_pairRoutes; // by i << 32 | j
+  std::list<uint64_t> m_pairLru;
+  uint32_t  m_pairCacheSize;
+  uint32_t  m_nPairSearches;
+  modcore::ContractionHierarchy<uint32_t, double> m_contraction;
+  modcore::LeafAggregation<uint32_t, double> m_aggregation;
+  modcore::ClusterHierarchy<uint32_t, double> m_hierarchy;
+  uint32_t  m_clusterSize;
+  uint32_t  m_stretchSamples;
+  Ptr<UniformRandomVariable> m_stretchRng;
+  TracedCallback<uint32_t, uint32_t, double> m_stretchTrace;
+  // geographic mode: nodes bucketed in txRange cells as of their last
+  // course change; none has moved more than m_geoSpeed * (now - m_geoBuilt)
+  // since
+  std::map<uint64_t, std::vector<uint32_t> > m_geoCells;
+  std::vector<uint64_t> m_geoCellOf;
+  Time      m_geoBuilt;
+  double    m_geoSpeed;
+
+  std::map<LinkKey, LinkState> m_state;
+  Time      m_holdDown;
+  double    m_flapPenalty;
+  double    m_suppressLimit;
+  double    m_reuseLimit;
+  Time      m_halfLife;
+  bool      m_dirty;
+  EventId   m_updateEvent;
+  bool      m_precomputeFailures;
+  uint32_t  m_precomputeThreads;
+  FailureDiffs m_failureDiffs; // per single link failure, against the matrices
+  size_t    m_activeDiff;      // diff swapped in, or FailureDiffs::NONE
+  // Kinetic mode: the next time each pair of nodes enters or leaves
+  // txRange, assuming constant velocities between course changes
+  bool      m_kinetic;
+  std::map<Ptr<const MobilityModel>, uint32_t> m_mobilityIndex;
+  std::multimap<Time, LinkKey> m_crossings;
+  std::map<LinkKey, std::multimap<Time, LinkKey>::iterator> m_crossingOf;
+  EventId   m_crossingEvent;
+  double    m_kineticRange; // txRange the predictions were made for
+  uint32_t  m_nCrossings;
+  // deterministic mobility: trajectories by node, and the precomputed
+  // timeline with the step installed last
+  std::vector<modcore::Trajectory> m_trajectory;
+  Timeline  m_timeline;
+  size_t    m_timelineStep;
+  EventId   m_timelineEvent;
+  uint32_t  m_nUpdateRequests;
+  uint32_t  m_nScheduledUpdates;
+
+  MulticastMode m_multicastMode;
+  std::map<Ipv4Address, std::set<uint32_t> > m_groups; // members by group
+  std::map<MulticastKey, MulticastTree> m_multicastTrees;
+
+  std::vector<uint32_t> m_component; // partition id of each node
+  uint32_t  m_nComponents;
 };
 
 }
@@ -20,12 +20,14 @@
 
 #include "ns3/log.h"
 #include "ns3/ipv4.h"
+#include "ns3/channel.h"
 #include "ns3/ipv4-route.h"
 #include "ns3/pointer.h"
 #include "ns3/double.h"
 #include "ns3/ipv4-static-routing.h"
 #include "mod-routing.h"
-#include "MyTag.h"
+#include "mod-failover-tag.h"
+#include "mod-source-route-tag.h"
  #include <list>
 #include <map>
 #include <vector>
@@ -83,12 +85,20 @@ ModRouting::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&ModRouting::SetRtable),
                    MakePointerChecker<ModRoutingTable> ())
+    .AddAttribute ("SourceRouting", "Write the full path into each packet at the ingress node "
+                   "and let transit nodes pop their next hop from it.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&ModRouting::m_sourceRouting),
+                   MakeBooleanChecker ())
     ;
   return tid;
 }
 
 
 ModRouting::ModRouting () 
+  : m_addressResolved (false),
+    m_ifaceId (0),
+    m_sourceRouting (false)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -101,33 +111,72 @@ ModRouting::~ModRouting ()
 Ptr<Ipv4Route>
 ModRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif, enum Socket::SocketErrno &sockerr)
 {
-  Ipv4Address relay = m_rtable->LookupRoute (m_address, header.GetDestination ());
+  ResolveAddress ();
+  if (header.GetDestination ().IsMulticast ())
+    {
+      return MulticastOutput (p, header, sockerr);
+    }
+  if (!m_rtable->IsReachable (m_address, header.GetDestination ()))
+    {
+      NS_LOG_DEBUG ("Can't find route!! " << header.GetDestination () << " is in another partition");
+      sockerr = Socket::ERROR_NOROUTETOHOST;
+      return 0;
+    }
+
+  Ipv4Address relay;
+  if (m_rtable->GetMode () == ModRoutingTable::GEOGRAPHIC)
+    {
+      ModGeoTag geo;
+      relay = m_rtable->LookupRoute (m_address, header.GetDestination (), geo.GetState ());
+      if (p != 0)
+        {
+          ModGeoTag old;
+          p->RemovePacketTag (old);
+          p->AddPacketTag (geo);
+        }
+    }
+  else if (m_sourceRouting && p != 0 && m_rtable->LookupStatic (m_address, header.GetDestination (), relay))
+    {
+      // a static route wins over the computed path, so nothing to record
+      ModSourceRouteTag old;
+      p->RemovePacketTag (old);
+    }
+  else if (m_sourceRouting && p != 0)
+    {
+      std::vector<uint32_t> path = m_rtable->GetPath (m_address, header.GetDestination ());
+      relay = path.empty () ? m_address : m_rtable->GetAddress (path[0]);
+      if (path.size () > ModSourceRouteTag::MAX_HOPS)
+        {
+          // too long for the tag: transit nodes look the route up themselves
+          NS_LOG_LOGIC ("Path of " << path.size () << " hops, not source routed");
+          ModSourceRouteTag old;
+          p->RemovePacketTag (old);
+        }
+      else if (!path.empty ())
+        {
+          // the first hop is taken here, transit nodes start at position 1
+          ModSourceRouteTag srcRoute;
+          p->RemovePacketTag (srcRoute);
+          srcRoute.SetPath (path, m_rtable->GetNNodes ());
+          srcRoute.SetCursor (1);
+          p->AddPacketTag (srcRoute);
+        }
+    }
+  else
+    {
+      relay = m_rtable->LookupRoute (m_address, header.GetDestination ());
+    }
   NS_LOG_FUNCTION (this << header.GetSource () << "->" << relay << "->" << header.GetDestination ());
   NS_LOG_INFO ("Relay to " << relay);
   if (m_address == relay)
     {
       NS_LOG_DEBUG ("Can't find route!!");
+      sockerr = Socket::ERROR_NOROUTETOHOST;
+      return 0;
     }
   
-  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
-  route->SetGateway (relay);
-  route->SetSource (m_address);
-  route->SetDestination (header.GetDestination ());
-  route->SetOutputDevice (m_ipv4->GetNetDevice (m_ifaceId));
-  
   sockerr = Socket::ERROR_NOTERROR;
-  
-  MyTag tagForPacket;
-  int numberOfSwitches = 10;
-  std::vector<uint8_t> vectorForPacket(numberOfSwitches);
-  for (int i = 0; i < numberOfSwitches; ++i)
-  {
-    /* code */
-    vectorForPacket.push_back(0x00);
-  }
-  tagForPacket.SetSimpleValue(vectorForPacket);
-  // p->AddPacketTag(tagForPacket);
-  return route;
+  return MakeRoute (m_address, header.GetDestination (), GetNextHop (relay));
 }
 
 bool 
@@ -136,83 +185,486 @@ ModRouting::RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const
                              LocalDeliverCallback lcb, ErrorCallback ecb)
 {
   NS_LOG_FUNCTION (header.GetDestination ());
-  MyTag tagForPacket;
-  p->PeekPacketTag(tagForPacket);
-  if (header.GetDestination () == m_address)
+  ResolveAddress ();
+  ModFailoverTag failover;
+  bool tagged = p->PeekPacketTag (failover);
+  uint32_t nodeId = idev->GetNode ()->GetId ();
+  // On its recorded path the packet names its own next hop, so a transit
+  // node skips the table.  After a failover detour, or where a static
+  // route overrides the path, the table takes over.
+  ModSourceRouteTag srcRoute;
+  uint8_t cursor = 0;
+  if (m_sourceRouting && failover.GetCursor (nodeId) == 0 && p->PeekPacketTag (srcRoute))
+    {
+      cursor = srcRoute.GetCursor ();
+    }
+  Ipv4Address staticRelay;
+  bool onSourceRoute = cursor > 0 && cursor < srcRoute.GetNHops ()
+    && m_rtable->GetAddress (srcRoute.GetHop (cursor - 1)) == m_address
+    && !m_rtable->LookupStatic (m_address, header.GetDestination (), staticRelay);
+  if (IsLocal (header.GetDestination ()))
     {
       NS_LOG_DEBUG ("I'm the destination");
-      lcb (p, header, m_ipv4->GetInterfaceForDevice (idev));
+      lcb (p, header, GetInterface (idev));
       return true;
     }
-  else if (header.GetDestination () == m_broadcast)
+  else if (IsBroadcast (header.GetDestination ()))
     {
       NS_LOG_DEBUG ("It's broadcast");
       return true;
     }
-  else if (tagForPacket.GetSimpleValueByIndex(idev->GetNode()->GetId()) == 0x00)
+  else if (header.GetDestination ().IsMulticast ())
     {
-      Ipv4Address relay = m_rtable->LookupRoute (m_address, header.GetDestination ());
-      NS_LOG_FUNCTION (this << m_address << "->" << relay << "->" << header.GetDestination ());
-      NS_LOG_DEBUG ("Relay to " << relay);
+      return MulticastInput (p, header, idev, mcb, lcb);
+    }
+  else if (!onSourceRoute && !m_rtable->IsReachable (m_address, header.GetDestination ()))
+    {
+      NS_LOG_DEBUG ("Can't find a route!! " << header.GetDestination () << " is in another partition");
+      ecb (p, header, Socket::ERROR_NOROUTETOHOST);
+      return true;
+    }
+  else if (!onSourceRoute && m_rtable->GetMode () == ModRoutingTable::GEOGRAPHIC)
+    {
+      return GeographicInput (p, header, ucb, ecb);
+    }
+  else if (failover.GetCursor (nodeId) == 0)
+    {
+      Ipv4Address relay;
+      if (onSourceRoute)
+        {
+          relay = m_rtable->GetAddress (srcRoute.GetHop (cursor));
+        }
+      else
+        {
+          relay = m_rtable->LookupRoute (m_address, header.GetDestination ());
+        }
       if (m_address == relay)
         {
           NS_LOG_DEBUG ("Can't find a route!!");
+          return FailoverInput (p, header, idev, failover, tagged, ucb, ecb);
+        }
+      Neighbor next = GetNextHop (relay);
+      const Interface &out = m_interfaces[next.iface];
+      if (m_downNeighbors.count (relay) > 0 || !out.up || !out.device->IsLinkUp ())
+        {
+          NS_LOG_DEBUG ("Link to " << relay << " is down");
+          return FailoverInput (p, header, idev, failover, tagged, ucb, ecb);
         }
-      Ptr<Ipv4Route> route = Create<Ipv4Route> ();
-      route->SetGateway (relay);
-      route->SetSource (header.GetSource ());
-      route->SetDestination (header.GetDestination ());
-      route->SetOutputDevice (m_ipv4->GetNetDevice (m_ifaceId));
-      ucb (route, p, header);
+      if (onSourceRoute)
+        {
+          srcRoute.SetCursor (cursor + 1);
+          ConstCast<Packet> (p)->ReplacePacketTag (srcRoute);
+        }
+      NS_LOG_FUNCTION (this << m_address << "->" << relay << "->" << header.GetDestination ());
+      NS_LOG_DEBUG ("Relay to " << relay);
+      ucb (MakeRoute (header.GetSource (), header.GetDestination (), next), p, header);
       return true;
     }
-    else{
-
-      int tagForPacketValue = tagForPacket.GetSimpleValueByIndex(idev->GetNode()->GetId());
-      int maxDevices = idev->GetNode()->GetNDevices();
-      int indexOfOutputDevice = (tagForPacketValue%maxDevices) +1;
-      Ptr<NetDevice>outputDevice = idev->GetNode()->GetDevice(indexOfOutputDevice);
-      tagForPacket.SetSimpleValueByIndex(idev->GetNode()->GetId(),(uint8_t)indexOfOutputDevice);
-      while (outputDevice->IsLinkUp() == false){
-        tagForPacketValue = tagForPacket.GetSimpleValueByIndex(idev->GetNode()->GetId());
-        maxDevices = idev->GetNode()->GetNDevices();
-        indexOfOutputDevice = (tagForPacketValue%maxDevices) +1;
-        Ptr<NetDevice>outputDevice = idev->GetNode()->GetDevice(indexOfOutputDevice);
-        tagForPacket.SetSimpleValueByIndex(idev->GetNode()->GetId(),(uint8_t)indexOfOutputDevice);
-      }
-      lcb(p,header,m_ipv4->GetInterfaceForDevice (outputDevice));
+
+  return FailoverInput (p, header, idev, failover, tagged, ucb, ecb);
+}
+
+// Geographic mode: the next hop comes from the positions in range and the
+// packet's greedy/perimeter state, which travels in a ModGeoTag.
+bool
+ModRouting::GeographicInput (Ptr<const Packet> p, const Ipv4Header &header,
+                             UnicastForwardCallback ucb, ErrorCallback ecb)
+{
+  ModGeoTag geo;
+  bool tagged = p->PeekPacketTag (geo);
+  Ipv4Address relay = m_rtable->LookupRoute (m_address, header.GetDestination (), geo.GetState ());
+  if (relay == m_address)
+    {
+      NS_LOG_DEBUG ("No neighbor towards " << header.GetDestination ());
+      ecb (p, header, Socket::ERROR_NOROUTETOHOST);
+      return true;
     }
-  return false;
+  if (tagged)
+    {
+      ConstCast<Packet> (p)->ReplacePacketTag (geo);
+    }
+  else
+    {
+      p->AddPacketTag (geo);
+    }
+  NS_LOG_DEBUG ("Relay to " << relay << (geo.GetState ().perimeter ? " (perimeter)" : ""));
+  ucb (MakeRoute (header.GetSource (), header.GetDestination (), GetNextHop (relay)), p, header);
+  return true;
+}
+
+// Multicast: the source sends one copy on the tree of (source, group) from
+// the shared table, however many members there are.  When its children are
+// behind different interfaces the copy goes through the loopback instead,
+// and RouteInput hands it out on each of them like a forwarded packet.
+Ptr<Ipv4Route>
+ModRouting::MulticastOutput (Ptr<Packet> p, const Ipv4Header &header, Socket::SocketErrno &sockerr)
+{
+  Ipv4Address group = header.GetDestination ();
+  Ipv4Address parent;
+  if (!m_rtable->GetMulticastHop (m_address, group, m_address, parent, m_children) || m_children.empty ())
+    {
+      NS_LOG_DEBUG ("No member of " << group << " to send to");
+      sockerr = Socket::ERROR_NOROUTETOHOST;
+      return 0;
+    }
+  if (p != 0)
+    {
+      ModMulticastTag old;
+      p->RemovePacketTag (old);
+      p->AddPacketTag (ModMulticastTag (m_address));
+    }
+  Neighbor next = GetNextHop (m_children[0]);
+  next.gateway = group;
+  for (uint32_t k = 1; k < m_children.size () && next.iface != 0; k++)
+    {
+      if (GetNextHop (m_children[k]).iface != next.iface)
+        {
+          next.iface = 0;
+          next.gateway = Ipv4Address::GetLoopback ();
+        }
+    }
+  sockerr = Socket::ERROR_NOTERROR;
+  return MakeRoute (m_address, group, next);
+}
+
+// A node keeps a multicast packet only when it comes from its parent on the
+// tree (or from itself, at the source), delivers it if it is a member, and
+// sends it once on each interface that has children behind it; children
+// sharing a medium all hear that one transmission.
+bool
+ModRouting::MulticastInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                            MulticastForwardCallback mcb, LocalDeliverCallback lcb)
+{
+  Ipv4Address group = header.GetDestination ();
+  ModMulticastTag tag;
+  Ipv4Address parent;
+  if (!p->PeekPacketTag (tag)
+      || !m_rtable->GetMulticastHop (header.GetSource (), group, m_address, parent, m_children)
+      || tag.GetSender () != parent)
+    {
+      NS_LOG_LOGIC ("Not below " << tag.GetSender () << " on the tree of " << header.GetSource () << " -> " << group);
+      return true;
+    }
+  uint32_t iif = GetInterface (idev);
+  if (header.GetSource () != m_address && m_rtable->IsGroupMember (group, m_address))
+    {
+      NS_LOG_DEBUG ("Member of " << group);
+      lcb (p, header, iif);
+    }
+  if (!m_children.empty ())
+    {
+      NS_LOG_DEBUG ("Forward to " << m_children.size () << " node(s) on the tree of " << group);
+      Ptr<Packet> copy = p->Copy ();
+      tag.SetSender (m_address);
+      copy->ReplacePacketTag (tag);
+      Ptr<Ipv4MulticastRoute> route = Create<Ipv4MulticastRoute> ();
+      route->SetGroup (group);
+      route->SetOrigin (header.GetSource ());
+      route->SetParent (iif);
+      for (uint32_t k = 0; k < m_children.size (); k++)
+        {
+          route->SetOutputTtl (GetNextHop (m_children[k]).iface, Ipv4MulticastRoute::MAX_TTL - 1);
+        }
+      mcb (route, copy, header);
+    }
+  return true;
+}
+
+// Failover: rotate through the node's devices, starting after the one this
+// packet used the last time it passed here, until one is up.
+bool
+ModRouting::FailoverInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                           ModFailoverTag &failover, bool tagged,
+                           UnicastForwardCallback ucb, ErrorCallback ecb)
+{
+  uint32_t nodeId = idev->GetNode ()->GetId ();
+  uint32_t maxDevices = m_ifaceOfDevice.size ();
+  uint8_t cursor = failover.GetCursor (nodeId);
+  Neighbor next;
+  bool found = false;
+  for (uint32_t tries = 0; tries < maxDevices && !found; ++tries)
+    {
+      cursor = (uint8_t)((cursor % maxDevices) + 1);
+      int32_t iface = m_ifaceOfDevice[cursor - 1];
+      // interface 0 is the loopback; the packet goes to the node across
+      // the link, which routes it on from there
+      found = iface > 0 && m_interfaces[iface].up && m_interfaces[iface].device->IsLinkUp ()
+        && GetLinkPeer (iface, Ptr<Node> (), next);
+    }
+  if (!found)
+    {
+      NS_LOG_DEBUG ("No device left to fail over to");
+      ecb (p, header, Socket::ERROR_NOROUTETOHOST);
+      return true;
+    }
+
+  failover.SetCursor (nodeId, cursor);
+  ModFailoverTag::Update (p, failover, tagged);
+  NS_LOG_DEBUG ("Failover to device " << (uint32_t)(cursor - 1));
+
+  ucb (MakeRoute (header.GetSource (), header.GetDestination (), next), p, header);
+  return true;
 }
 
+// The node is up while any of its interfaces other than the loopback is;
+// next hops behind a down interface take the failover path.
 void 
 ModRouting::NotifyInterfaceUp (uint32_t interface)
 {
   NS_LOG_FUNCTION (this << interface);
+  if (interface >= m_interfaces.size ())
+    {
+      RefreshInterfaces ();
+    }
+  bool wasUp = false;
+  for (uint32_t i = 1; i < m_interfaces.size (); i++)
+    {
+      wasUp = wasUp || (i != interface && m_interfaces[i].up);
+    }
+  if (interface < m_interfaces.size ())
+    {
+      m_interfaces[interface].up = true;
+    }
+  // the shared table coalesces the recomputes of all nodes
+  if (m_rtable != 0 && interface > 0 && !wasUp)
+    {
+      m_rtable->NotifyNodeUp (m_address);
+    }
 }
 void 
 ModRouting::NotifyInterfaceDown (uint32_t interface)
 {
   NS_LOG_FUNCTION (this << interface);
+  if (interface < m_interfaces.size ())
+    {
+      m_interfaces[interface].up = false;
+    }
+  bool up = false;
+  for (uint32_t i = 1; i < m_interfaces.size (); i++)
+    {
+      up = up || m_interfaces[i].up;
+    }
+  if (m_rtable != 0 && interface > 0 && !up)
+    {
+      m_rtable->NotifyNodeDown (m_address);
+    }
 }
 void 
 ModRouting::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
 {
   NS_LOG_FUNCTION(this << interface << address << m_rtable);
-  m_ifaceId = interface;
-  m_address = address.GetLocal ();
-  m_broadcast = address.GetBroadcast ();
+  RefreshInterfaces ();
 }
 void 
 ModRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
 {
   NS_LOG_FUNCTION(this << interface << address);
+  RefreshInterfaces ();
 }
 void 
 ModRouting::SetIpv4 (Ptr<Ipv4> ipv4)
 {
   NS_LOG_FUNCTION(this << ipv4);
   m_ipv4 = ipv4;
+  RefreshInterfaces ();
+}
+
+// Interfaces with their devices and first addresses, and the interface of
+// each of the node's devices, so that no packet searches for them.
+void
+ModRouting::RefreshInterfaces (void)
+{
+  m_interfaces.clear ();
+  m_ifaceOfDevice.clear ();
+  m_neighbors.clear ();
+  m_addressResolved = false;
+  if (m_ipv4 == 0)
+    {
+      return;
+    }
+  Ptr<Node> node = m_ipv4->GetObject<Node> ();
+  m_ifaceOfDevice.assign (node != 0 ? node->GetNDevices () : 0, -1);
+  for (uint32_t i = 0; i < m_ipv4->GetNInterfaces (); i++)
+    {
+      Interface entry;
+      entry.device = m_ipv4->GetNetDevice (i);
+      entry.address = Ipv4Address::GetZero ();
+      entry.broadcast = Ipv4Address::GetZero ();
+      entry.up = m_ipv4->IsUp (i);
+      if (m_ipv4->GetNAddresses (i) > 0)
+        {
+          entry.address = m_ipv4->GetAddress (i, 0).GetLocal ();
+          entry.broadcast = m_ipv4->GetAddress (i, 0).GetBroadcast ();
+        }
+      if (entry.device != 0 && entry.device->GetIfIndex () < m_ifaceOfDevice.size ())
+        {
+          m_ifaceOfDevice[entry.device->GetIfIndex ()] = i;
+        }
+      m_interfaces.push_back (entry);
+    }
+  ResolveAddress ();
+}
+
+// The table knows a node by one address, on a node with several interfaces
+// whichever was given to AddNode.  Until the node is registered the first
+// address stands in, and every packet tries again.
+void
+ModRouting::ResolveAddress (void)
+{
+  if (m_addressResolved)
+    {
+      return;
+    }
+  Ptr<Node> node = m_ipv4 != 0 ? m_ipv4->GetObject<Node> () : Ptr<Node> ();
+  bool first = true;
+  for (uint32_t i = 1; i < m_interfaces.size (); i++)
+    {
+      Ipv4Address addr = m_interfaces[i].address;
+      if (addr == Ipv4Address::GetZero ())
+        {
+          continue;
+        }
+      if (first)
+        {
+          m_address = addr;
+          m_ifaceId = i;
+          first = false;
+        }
+      if (m_rtable != 0 && node != 0 && m_rtable->GetNode (addr) == node)
+        {
+          m_address = addr;
+          m_ifaceId = i;
+          m_addressResolved = true;
+          return;
+        }
+    }
+}
+
+// Interface and link address for a next hop the table named by its node
+// address: the first interface (the main one first) whose channel the
+// next hop has a device on.  Resolved once per next hop; one not found
+// goes out the main interface to its table address.
+ModRouting::Neighbor
+ModRouting::GetNextHop (Ipv4Address relay)
+{
+  Neighbor next = { m_ifaceId, relay };
+  if (relay == m_address)
+    {
+      return next;
+    }
+  std::map<Ipv4Address, Neighbor>::const_iterator it = m_neighbors.find (relay);
+  if (it != m_neighbors.end ())
+    {
+      return it->second;
+    }
+  Ptr<Node> peer = m_rtable->GetNode (relay);
+  uint32_t n = m_interfaces.size ();
+  for (uint32_t k = 0; peer != 0 && k < n; k++)
+    {
+      if (GetLinkPeer ((m_ifaceId + k) % n, peer, next))
+        {
+          break;
+        }
+    }
+  m_neighbors[relay] = next;
+  return next;
+}
+
+// The address on the link of interface iface of peer, or of the first
+// other node on it when peer is 0.
+bool
+ModRouting::GetLinkPeer (uint32_t iface, Ptr<Node> peer, Neighbor &next) const
+{
+  Ptr<NetDevice> own = iface > 0 && iface < m_interfaces.size () ? m_interfaces[iface].device : Ptr<NetDevice> ();
+  Ptr<Channel> channel = own != 0 ? own->GetChannel () : Ptr<Channel> ();
+  for (std::size_t d = 0; channel != 0 && d < channel->GetNDevices (); d++)
+    {
+      Ptr<NetDevice> device = channel->GetDevice (d);
+      Ptr<Node> node = device->GetNode ();
+      // without a given peer (failover) any neighbor on the link but a
+      // failed one will do
+      if (node == own->GetNode () || (peer != 0 && node != peer) || (peer == 0 && IsNeighborDown (node)))
+        {
+          continue;
+        }
+      Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+      int32_t j = ipv4 != 0 ? ipv4->GetInterfaceForDevice (device) : -1;
+      if (j >= 0 && ipv4->GetNAddresses (j) > 0)
+        {
+          next.iface = iface;
+          next.gateway = ipv4->GetAddress (j, 0).GetLocal ();
+          return true;
+        }
+      if (peer != 0)
+        {
+          return false;
+        }
+    }
+  return false;
+}
+
+// Injected link failures only report the neighbor down, the device
+// itself stays up.
+bool
+ModRouting::IsNeighborDown (Ptr<Node> node) const
+{
+  for (std::set<Ipv4Address>::const_iterator it = m_downNeighbors.begin (); it != m_downNeighbors.end (); ++it)
+    {
+      if (m_rtable->GetNode (*it) == node)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+uint32_t
+ModRouting::GetInterface (Ptr<const NetDevice> device) const
+{
+  uint32_t index = device->GetIfIndex ();
+  if (index < m_ifaceOfDevice.size () && m_ifaceOfDevice[index] >= 0)
+    {
+      return m_ifaceOfDevice[index];
+    }
+  return m_ipv4->GetInterfaceForDevice (device);
+}
+
+bool
+ModRouting::IsLocal (Ipv4Address addr) const
+{
+  for (uint32_t i = 1; i < m_interfaces.size (); i++)
+    {
+      if (m_interfaces[i].address == addr)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+bool
+ModRouting::IsBroadcast (Ipv4Address addr) const
+{
+  for (uint32_t i = 1; i < m_interfaces.size (); i++)
+    {
+      if (m_interfaces[i].address != Ipv4Address::GetZero () && m_interfaces[i].broadcast == addr)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+Ptr<Ipv4Route>
+ModRouting::MakeRoute (Ipv4Address source, Ipv4Address destination, const Neighbor &next)
+{
+  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+  route->SetGateway (next.gateway);
+  route->SetSource (source);
+  route->SetDestination (destination);
+  route->SetOutputDevice (next.iface < m_interfaces.size () ? m_interfaces[next.iface].device
+                                                            : m_ipv4->GetNetDevice (next.iface));
+  return route;
 }
 void
 ModRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
@@ -221,10 +673,24 @@ ModRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
   m_rtable->Print (stream);
 }
 void
+ModRouting::NotifyNeighborDown (Ipv4Address neighbor)
+{
+  NS_LOG_FUNCTION (this << neighbor);
+  m_downNeighbors.insert (neighbor);
+}
+void
+ModRouting::NotifyNeighborUp (Ipv4Address neighbor)
+{
+  NS_LOG_FUNCTION (this << neighbor);
+  m_downNeighbors.erase (neighbor);
+}
+void
 ModRouting::SetRtable (Ptr<ModRoutingTable> p)
 {
   NS_LOG_FUNCTION(p);
   m_rtable = p;
+  m_addressResolved = false;
+  m_neighbors.clear ();
 }
 
 } // namespace ns3
@@ -22,8 +22,14 @@
 #define MOD_ROUTING_H
 
 #include <list>
+#include <map>
+#include <set>
+#include <vector>
 #include "ns3/ipv4-routing-protocol.h"
 #include "mod-routing-table.h"
+#include "mod-failover-tag.h"
+#include "mod-geo-tag.h"
+#include "mod-multicast-tag.h"
 
 namespace ns3 {
 
@@ -49,14 +55,59 @@ public:
   virtual void PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const;
   
   void SetRtable (Ptr<ModRoutingTable> prt);
+  // Link to a neighbor failed or came back.  Packets whose next hop is a
+  // failed neighbor take the failover path straight away.
+  void NotifyNeighborDown (Ipv4Address neighbor);
+  void NotifyNeighborUp (Ipv4Address neighbor);
   
 protected:
 private:
+  // one per Ipv4 interface, the loopback included
+  struct Interface
+  {
+    Ptr<NetDevice> device;
+    Ipv4Address address;   // first address, 0.0.0.0 if none
+    Ipv4Address broadcast;
+    bool up;
+  };
+  // a next hop: the interface that reaches it and its address on that link
+  struct Neighbor
+  {
+    uint32_t iface;
+    Ipv4Address gateway;
+  };
+
+  void RefreshInterfaces (void);
+  void ResolveAddress (void);
+  Neighbor GetNextHop (Ipv4Address relay);
+  bool GetLinkPeer (uint32_t iface, Ptr<Node> peer, Neighbor &next) const;
+  bool IsNeighborDown (Ptr<Node> node) const;
+  uint32_t GetInterface (Ptr<const NetDevice> device) const;
+  bool IsLocal (Ipv4Address addr) const;
+  bool IsBroadcast (Ipv4Address addr) const;
+  Ptr<Ipv4Route> MakeRoute (Ipv4Address source, Ipv4Address destination, const Neighbor &next);
+  bool FailoverInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                      ModFailoverTag &failover, bool tagged,
+                      UnicastForwardCallback ucb, ErrorCallback ecb);
+  bool GeographicInput (Ptr<const Packet> p, const Ipv4Header &header,
+                        UnicastForwardCallback ucb, ErrorCallback ecb);
+  Ptr<Ipv4Route> MulticastOutput (Ptr<Packet> p, const Ipv4Header &header, Socket::SocketErrno &sockerr);
+  bool MulticastInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                       MulticastForwardCallback mcb, LocalDeliverCallback lcb);
+
   Ptr<ModRoutingTable> m_rtable;
-  Ipv4Address m_address;
-  Ipv4Address m_broadcast;
+  Ipv4Address m_address;     // the address the table knows this node by
+  bool m_addressResolved;
   Ptr<Ipv4> m_ipv4;
-  uint32_t m_ifaceId;
+  uint32_t m_ifaceId;        // interface of m_address, used for unknown next hops
+  bool m_sourceRouting;
+  std::set<Ipv4Address> m_downNeighbors;
+  // rebuilt when interfaces or addresses change; next hops are resolved
+  // on first use, as a peer may get its address after this node
+  std::vector<Interface> m_interfaces;   // by interface index
+  std::vector<int32_t> m_ifaceOfDevice;  // by device index on the node, -1 if none
+  std::map<Ipv4Address, Neighbor> m_neighbors;
+  std::vector<Ipv4Address> m_children;   // scratch for multicast lookups
 };
 
 } //namespace ns3
@@ -0,0 +1,150 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "ns3/log.h"
+#include "mod-source-route-tag.h"
+
+NS_LOG_COMPONENT_DEFINE ("ModSourceRouteTag");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ModSourceRouteTag);
+
+TypeId
+ModSourceRouteTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ModSourceRouteTag")
+    .SetParent<Tag> ()
+    .AddConstructor<ModSourceRouteTag> ()
+    ;
+  return tid;
+}
+
+ModSourceRouteTag::ModSourceRouteTag ()
+  : m_bits (1),
+    m_nHops (0),
+    m_cursor (0)
+{
+}
+
+TypeId
+ModSourceRouteTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+ModSourceRouteTag::GetSerializedSize (void) const
+{
+  return 3 + m_packed.size ();
+}
+
+void
+ModSourceRouteTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_bits);
+  i.WriteU8 (m_nHops);
+  i.WriteU8 (m_cursor);
+  if (!m_packed.empty ())
+    {
+      i.Write (&m_packed[0], m_packed.size ());
+    }
+}
+
+void
+ModSourceRouteTag::Deserialize (TagBuffer i)
+{
+  m_bits = i.ReadU8 ();
+  m_nHops = i.ReadU8 ();
+  m_cursor = i.ReadU8 ();
+  m_packed.resize ((m_bits * m_nHops + 7) / 8);
+  if (!m_packed.empty ())
+    {
+      i.Read (&m_packed[0], m_packed.size ());
+    }
+}
+
+void
+ModSourceRouteTag::Print (std::ostream &os) const
+{
+  os << "route=";
+  for (uint8_t k = 0; k < m_nHops; k++)
+    {
+      os << (k == m_cursor ? "*" : "") << GetHop (k) << " ";
+    }
+}
+
+void
+ModSourceRouteTag::SetPath (const std::vector<uint32_t> &path, uint32_t nNodes)
+{
+  NS_ASSERT (path.size () <= MAX_HOPS);
+  m_bits = 1;
+  while (m_bits < 32 && (1u << m_bits) < nNodes)
+    {
+      m_bits++;
+    }
+  m_nHops = path.size ();
+  m_cursor = 0;
+  m_packed.assign ((m_bits * m_nHops + 7) / 8, 0);
+
+  uint32_t bit = 0;
+  for (uint8_t k = 0; k < m_nHops; k++)
+    {
+      for (uint8_t b = 0; b < m_bits; b++, bit++)
+        {
+          if (path[k] & (1u << b))
+            {
+              m_packed[bit / 8] |= (uint8_t)(1u << (bit % 8));
+            }
+        }
+    }
+}
+
+uint32_t
+ModSourceRouteTag::GetHop (uint8_t position) const
+{
+  NS_ASSERT (position < m_nHops);
+  uint32_t hop = 0;
+  uint32_t bit = position * m_bits;
+  for (uint8_t b = 0; b < m_bits; b++, bit++)
+    {
+      if (m_packed[bit / 8] & (1u << (bit % 8)))
+        {
+          hop |= (uint32_t)(1u << b);
+        }
+    }
+  return hop;
+}
+
+uint8_t
+ModSourceRouteTag::GetNHops (void) const
+{
+  return m_nHops;
+}
+
+uint8_t
+ModSourceRouteTag::GetCursor (void) const
+{
+  return m_cursor;
+}
+
+void
+ModSourceRouteTag::SetCursor (uint8_t cursor)
+{
+  m_cursor = cursor;
+}
+
+}
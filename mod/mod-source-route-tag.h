@@ -0,0 +1,62 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MOD_SOURCE_ROUTE_TAG_H
+#define MOD_SOURCE_ROUTE_TAG_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/tag.h"
+
+namespace ns3 {
+
+// Full path written by the ingress node, as ModRoutingTable node indices
+// packed at ceil(log2(n)) bits each.  m_cursor is the position of the next
+// hop; it is the only field transit nodes change, so the tag keeps its size
+// and can be replaced in place.
+class ModSourceRouteTag : public Tag
+{
+public:
+  // longest path a tag can carry; the hop count and cursor are one byte
+  static const uint8_t MAX_HOPS = 255;
+
+  ModSourceRouteTag ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  // path.size () must not exceed MAX_HOPS
+  void SetPath (const std::vector<uint32_t> &path, uint32_t nNodes);
+  uint32_t GetHop (uint8_t position) const;
+  uint8_t GetNHops (void) const;
+
+  uint8_t GetCursor (void) const;
+  void SetCursor (uint8_t cursor);
+
+private:
+  uint8_t m_bits;
+  uint8_t m_nHops;
+  uint8_t m_cursor;
+  std::vector<uint8_t> m_packed;
+};
+
+}
+
+#endif /* MOD_SOURCE_ROUTE_TAG_H */
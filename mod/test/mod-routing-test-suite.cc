@@ -0,0 +1,638 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+// ModRoutingTable against a Dijkstra reference on small random
+// topologies, one test case per table mode and metric, and time and
+// memory budgets for the table build and per-packet lookup.  Also
+// ModFatTreeRouting walked port by port over whole fat-trees.
+//
+//   ./test.py -s mod-routing
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <queue>
+#include <set>
+#include <string>
+#include <vector>
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/enum.h"
+#include "ns3/node.h"
+#include "ns3/node-container.h"
+#include "ns3/ipv4.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/mod-routing-table.h"
+#include "ns3/mod-fat-tree-helper.h"
+
+using namespace ns3;
+
+namespace {
+
+typedef std::vector<std::vector<std::pair<uint32_t, double> > > Links;
+
+// A table with the links it was given kept aside for the reference: in
+// range of each other for wireless nodes, added with AddLink when wired.
+struct Topology
+{
+  Ptr<ModRoutingTable> table;
+  std::vector<Ipv4Address> addrs;
+  Links links;
+  double txRange;
+};
+
+std::string
+ModeName (ModRoutingTable::Mode mode)
+{
+  static const char *names[] = { "Eager", "LazySource", "LazyDestination", "Hierarchical",
+                                 "Geographic", "OnDemand", "Contraction", "Aggregated" };
+  return names[mode];
+}
+
+Ptr<ModRoutingTable>
+MakeTable (ModRoutingTable::Mode mode, ModRoutingTable::Metric metric)
+{
+  Ptr<ModRoutingTable> table = CreateObject<ModRoutingTable> ();
+  table->SetAttribute ("Mode", EnumValue (mode));
+  table->SetAttribute ("Metric", EnumValue (metric));
+  return table;
+}
+
+// wired nodes (no position) get no mobility model
+void
+AddNode (Topology &t, const Vector *position)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  if (position != 0)
+    {
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (*position);
+      node->AggregateObject (mobility);
+    }
+  Ipv4Address addr (0x0a000001 + t.addrs.size ());
+  t.table->AddNode (node, addr);
+  t.addrs.push_back (addr);
+  t.links.resize (t.addrs.size ());
+}
+
+// n nodes placed at random in a side x side square
+Topology
+MakeWireless (Ptr<ModRoutingTable> table, uint32_t n, double side, double txRange,
+              Ptr<UniformRandomVariable> rng)
+{
+  Topology t;
+  t.table = table;
+  t.txRange = txRange;
+  std::vector<Vector> pos;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      pos.push_back (Vector (rng->GetValue (0, side), rng->GetValue (0, side), 0));
+      AddNode (t, &pos.back ());
+    }
+  bool euclidean = table->GetMetric () == ModRoutingTable::EUCLIDEAN;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      for (uint32_t j = i + 1; j < n; j++)
+        {
+          double d = CalculateDistance (pos[i], pos[j]);
+          if (d > 0 && d <= txRange)
+            {
+              t.links[i].push_back (std::make_pair (j, euclidean ? d : 1.0));
+              t.links[j].push_back (std::make_pair (i, euclidean ? d : 1.0));
+            }
+        }
+    }
+  return t;
+}
+
+void
+AddWiredLink (Topology &t, std::set<std::pair<uint32_t, uint32_t> > &seen, uint32_t u, uint32_t v)
+{
+  if (u == v || !seen.insert (std::make_pair (std::min (u, v), std::max (u, v))).second)
+    {
+      return;
+    }
+  t.table->AddLink (t.addrs[u], t.addrs[v]);
+  t.links[u].push_back (std::make_pair (v, 1.0));
+  t.links[v].push_back (std::make_pair (u, 1.0));
+}
+
+// a random tree of n nodes plus extra random links; wired tables count hops
+Topology
+MakeWired (Ptr<ModRoutingTable> table, uint32_t n, uint32_t extra, Ptr<UniformRandomVariable> rng)
+{
+  Topology t;
+  t.table = table;
+  t.txRange = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      AddNode (t, 0);
+    }
+  std::set<std::pair<uint32_t, uint32_t> > seen;
+  for (uint32_t i = 1; i < n; i++)
+    {
+      AddWiredLink (t, seen, i, rng->GetInteger (0, i - 1));
+    }
+  for (uint32_t e = 0; e < extra; e++)
+    {
+      AddWiredLink (t, seen, rng->GetInteger (0, n - 1), rng->GetInteger (0, n - 1));
+    }
+  return t;
+}
+
+// spines over leaf switches over hosts, every leaf linked to every spine
+Topology
+MakeLeafSpine (Ptr<ModRoutingTable> table, uint32_t spines, uint32_t leaves, uint32_t hosts)
+{
+  Topology t;
+  t.table = table;
+  t.txRange = 0;
+  for (uint32_t i = 0; i < spines + leaves * (1 + hosts); i++)
+    {
+      AddNode (t, 0);
+    }
+  std::set<std::pair<uint32_t, uint32_t> > seen;
+  for (uint32_t l = 0; l < leaves; l++)
+    {
+      uint32_t leaf = spines + l;
+      for (uint32_t s = 0; s < spines; s++)
+        {
+          AddWiredLink (t, seen, s, leaf);
+        }
+      for (uint32_t h = 0; h < hosts; h++)
+        {
+          AddWiredLink (t, seen, leaf, spines + leaves + l * hosts + h);
+        }
+    }
+  return t;
+}
+
+std::vector<double>
+Dijkstra (const Links &links, uint32_t src)
+{
+  typedef std::pair<double, uint32_t> Entry;
+  std::vector<double> dist (links.size (), HUGE_VAL);
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > queue;
+  dist[src] = 0;
+  queue.push (Entry (0, src));
+  while (!queue.empty ())
+    {
+      Entry e = queue.top ();
+      queue.pop ();
+      if (e.first > dist[e.second])
+        {
+          continue;
+        }
+      for (uint32_t k = 0; k < links[e.second].size (); k++)
+        {
+          uint32_t v = links[e.second][k].first;
+          double d = e.first + links[e.second][k].second;
+          if (d < dist[v])
+            {
+              dist[v] = d;
+              queue.push (Entry (d, v));
+            }
+        }
+    }
+  return dist;
+}
+
+// cost of the link u-v, -1 if there is none
+double
+LinkCost (const Links &links, uint32_t u, uint32_t v)
+{
+  for (uint32_t k = 0; k < links[u].size (); k++)
+    {
+      if (links[u][k].first == v)
+        {
+          return links[u][k].second;
+        }
+    }
+  return -1;
+}
+
+uint32_t
+IndexOf (const Topology &t, Ipv4Address addr)
+{
+  return std::find (t.addrs.begin (), t.addrs.end (), addr) - t.addrs.begin ();
+}
+
+double
+Tolerance (double length)
+{
+  return 1e-9 * std::max (1.0, length);
+}
+
+// A flow's hash at one node, salted with the node's address as FlowHash
+// salts it, so that successive stages split flows independently.
+uint32_t
+FlowHash (uint32_t flow, Ipv4Address src, Ipv4Address dst, Ipv4Address at)
+{
+  uint32_t h = flow * 2654435761u;
+  h ^= src.Get () * 2246822519u;
+  h ^= dst.Get () * 3266489917u;
+  h ^= at.Get () * 668265263u;
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+} // anonymous namespace
+
+// Every pair of a few random topologies.  The exact modes must return a
+// next hop on a shortest path and report its length; HIERARCHICAL and
+// GEOGRAPHIC must deliver over real links, report the length of the route
+// they take and, for HIERARCHICAL, stay within MAX_STRETCH of shortest.
+class ModRoutesTestCase : public TestCase
+{
+public:
+  ModRoutesTestCase (ModRoutingTable::Mode mode, ModRoutingTable::Metric metric, bool wired);
+
+private:
+  // above the 4-7 seen at these sizes, well below what picking border
+  // links without regard to the destination gives
+  static const double MAX_STRETCH;
+
+  virtual void DoRun (void);
+  void CheckPair (const Topology &t, uint32_t s, uint32_t d, const std::vector<std::vector<double> > &ref);
+
+  ModRoutingTable::Mode m_mode;
+  ModRoutingTable::Metric m_metric;
+  bool m_wired;
+};
+
+const double ModRoutesTestCase::MAX_STRETCH = 10;
+
+ModRoutesTestCase::ModRoutesTestCase (ModRoutingTable::Mode mode, ModRoutingTable::Metric metric, bool wired)
+  : TestCase (ModeName (mode) + (metric == ModRoutingTable::EUCLIDEAN ? " routes, Euclidean" : " routes, hop count")
+              + (wired ? ", wired" : ", wireless")),
+    m_mode (mode),
+    m_metric (metric),
+    m_wired (wired)
+{
+}
+
+void
+ModRoutesTestCase::DoRun (void)
+{
+  RngSeedManager::SetSeed (1);
+  for (uint32_t run = 1; run <= 3; run++)
+    {
+      RngSeedManager::SetRun (run);
+      Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+      Ptr<ModRoutingTable> table = MakeTable (m_mode, m_metric);
+      // wireless nodes have about 8 neighbors each, sparse enough for
+      // some partitions
+      Topology t = m_wired ? MakeWired (table, 60, 30, rng) : MakeWireless (table, 60, 500, 120, rng);
+      table->UpdateRoute (t.txRange);
+      std::vector<std::vector<double> > ref;
+      for (uint32_t s = 0; s < t.addrs.size (); s++)
+        {
+          ref.push_back (Dijkstra (t.links, s));
+        }
+      for (uint32_t s = 0; s < t.addrs.size (); s++)
+        {
+          for (uint32_t d = 0; d < t.addrs.size (); d++)
+            {
+              if (d != s)
+                {
+                  CheckPair (t, s, d, ref);
+                }
+            }
+        }
+      table->Dispose ();
+    }
+  Simulator::Destroy ();
+}
+
+void
+ModRoutesTestCase::CheckPair (const Topology &t, uint32_t s, uint32_t d, const std::vector<std::vector<double> > &ref)
+{
+  double shortest = ref[s][d];
+  Ptr<ModRoutingTable> table = t.table;
+  bool exact = m_mode != ModRoutingTable::HIERARCHICAL && m_mode != ModRoutingTable::GEOGRAPHIC;
+  bool geographic = m_mode == ModRoutingTable::GEOGRAPHIC;
+  Ipv4Address src = t.addrs[s];
+  Ipv4Address dst = t.addrs[d];
+
+  if (shortest == HUGE_VAL)
+    {
+      // GEOGRAPHIC knows no partitions and tries every pair
+      if (!geographic)
+        {
+          NS_TEST_ASSERT_MSG_EQ (table->IsReachable (src, dst), false, src << " -> " << dst << " is partitioned");
+          NS_TEST_ASSERT_MSG_EQ (table->LookupRoute (src, dst), src, src << " -> " << dst << " has a next hop");
+        }
+      return;
+    }
+  NS_TEST_ASSERT_MSG_EQ (table->IsReachable (src, dst), true, src << " -> " << dst << " is connected");
+
+  if (exact)
+    {
+      uint32_t next = IndexOf (t, table->LookupRoute (src, dst));
+      NS_TEST_ASSERT_MSG_LT (next, t.addrs.size (), src << " -> " << dst << ": unknown next hop");
+      double cost = LinkCost (t.links, s, next);
+      NS_TEST_ASSERT_MSG_GT (cost, 0, src << " -> " << dst << ": next hop " << t.addrs[next] << " is not a neighbor");
+      NS_TEST_ASSERT_MSG_EQ_TOL (cost + ref[next][d], shortest, Tolerance (shortest),
+                                 src << " -> " << dst << ": next hop " << t.addrs[next] << " is off the shortest paths");
+      NS_TEST_ASSERT_MSG_EQ_TOL (table->GetDistance (src, dst), shortest, Tolerance (shortest),
+                                 src << " -> " << dst << ": wrong distance");
+    }
+
+  // follow the route hop by hop, as the packets would
+  modcore::GeoState<uint32_t> state;
+  double length = 0;
+  uint32_t k = s;
+  for (uint32_t hops = 0; k != d; hops++)
+    {
+      NS_TEST_ASSERT_MSG_LT (hops, 4 * t.addrs.size (), src << " -> " << dst << " loops");
+      Ipv4Address relay = geographic ? table->LookupRoute (t.addrs[k], dst, state) : table->LookupRoute (t.addrs[k], dst);
+      uint32_t next = IndexOf (t, relay);
+      NS_TEST_ASSERT_MSG_LT (next, t.addrs.size (), src << " -> " << dst << " stops at " << t.addrs[k]);
+      double cost = LinkCost (t.links, k, next);
+      NS_TEST_ASSERT_MSG_GT (cost, 0, src << " -> " << dst << ": " << t.addrs[k] << " -> " << relay << " is not a link");
+      length += cost;
+      k = next;
+    }
+  NS_TEST_ASSERT_MSG_EQ_TOL (table->GetDistance (src, dst), length, Tolerance (length),
+                             src << " -> " << dst << ": distance is not the length of the route");
+  if (exact)
+    {
+      NS_TEST_ASSERT_MSG_EQ_TOL (length, shortest, Tolerance (shortest), src << " -> " << dst << ": route is not shortest");
+    }
+  else
+    {
+      NS_TEST_ASSERT_MSG_GT (length, shortest - Tolerance (shortest), src << " -> " << dst << ": route shorter than shortest");
+    }
+  if (m_mode == ModRoutingTable::HIERARCHICAL)
+    {
+      NS_TEST_ASSERT_MSG_LT (length / shortest, MAX_STRETCH, src << " -> " << dst << ": stretch " << length / shortest);
+    }
+}
+
+// Build time, lookup time and table bytes against fixed budgets, so that a
+// change making any of them grow by an order of magnitude fails.  The time
+// budgets leave room for debug builds on slow machines; the byte budgets
+// follow from what each mode keeps.
+class ModBudgetTestCase : public TestCase
+{
+public:
+  ModBudgetTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void CheckBudget (ModRoutingTable::Mode mode, double maxBuildMs, double maxLookupNs, double maxBytes);
+  void CheckAggregated (void);
+};
+
+ModBudgetTestCase::ModBudgetTestCase ()
+  : TestCase ("Build, lookup and memory budgets")
+{
+}
+
+void
+ModBudgetTestCase::DoRun (void)
+{
+  RngSeedManager::SetSeed (1);
+  RngSeedManager::SetRun (1);
+  double n = 1000;
+  double matrices = n * n * (sizeof (uint32_t) + sizeof (double));
+  CheckBudget (ModRoutingTable::EAGER, 5000, 10000, 1.25 * matrices);
+  CheckBudget (ModRoutingTable::HIERARCHICAL, 5000, 20000, 0.2 * matrices);
+  CheckBudget (ModRoutingTable::CONTRACTION, 5000, 500000, 0.2 * matrices);
+  CheckAggregated ();
+  Simulator::Destroy ();
+}
+
+void
+ModBudgetTestCase::CheckBudget (ModRoutingTable::Mode mode, double maxBuildMs, double maxLookupNs, double maxBytes)
+{
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  Ptr<ModRoutingTable> table = MakeTable (mode, ModRoutingTable::HOP_COUNT);
+  // 1000 nodes with about 10 neighbors each
+  Topology t = MakeWireless (table, 1000, 1800, 100, rng);
+  SystemWallClockMs clock;
+  clock.Start ();
+  table->UpdateRoute (t.txRange);
+  double buildMs = clock.End ();
+  NS_TEST_ASSERT_MSG_LT (buildMs, maxBuildMs, ModeName (mode) << " build took " << buildMs << " ms");
+
+  const uint32_t lookups = 100000;
+  std::vector<Ipv4Address> pairs;
+  for (uint32_t q = 0; q < 2 * lookups; q++)
+    {
+      pairs.push_back (t.addrs[rng->GetInteger (0, t.addrs.size () - 1)]);
+    }
+  clock.Start ();
+  for (uint32_t q = 0; q < lookups; q++)
+    {
+      table->LookupRoute (pairs[2 * q], pairs[2 * q + 1]);
+    }
+  double lookupNs = clock.End () * 1e6 / lookups;
+  NS_TEST_ASSERT_MSG_LT (lookupNs, maxLookupNs, ModeName (mode) << " lookup took " << lookupNs << " ns");
+
+  double bytes = table->GetMemoryUsage ();
+  NS_TEST_ASSERT_MSG_LT (bytes, maxBytes, ModeName (mode) << " table holds " << bytes << " bytes");
+  table->Dispose ();
+}
+
+// Hosts share their leaf switch's row: rows and bytes follow the switches.
+void
+ModBudgetTestCase::CheckAggregated (void)
+{
+  Ptr<ModRoutingTable> table = MakeTable (ModRoutingTable::AGGREGATED, ModRoutingTable::HOP_COUNT);
+  Topology t = MakeLeafSpine (table, 4, 16, 16);
+  table->UpdateRoute (0);
+  NS_TEST_ASSERT_MSG_EQ (table->GetNAggregatedRows (), 20, "only the switches keep rows");
+  double n = t.addrs.size ();
+  double bytes = table->GetMemoryUsage ();
+  NS_TEST_ASSERT_MSG_LT (bytes, 0.1 * n * n * (sizeof (uint32_t) + sizeof (double)),
+                         "Aggregated table holds " << bytes << " bytes");
+  std::vector<double> ref = Dijkstra (t.links, t.addrs.size () - 1);
+  for (uint32_t d = 0; d + 1 < t.addrs.size (); d++)
+    {
+      NS_TEST_ASSERT_MSG_EQ_TOL (table->GetDistance (t.addrs.back (), t.addrs[d]), ref[d], Tolerance (ref[d]),
+                                 "wrong distance to " << t.addrs[d]);
+    }
+  table->Dispose ();
+}
+
+// Every pair of nodes of a k-ary fat-tree, for FLOWS flows each, walked
+// with GetPort and GetNeighbor as RouteInput forwards: each must arrive
+// within 6 hops (up through edge, aggregation and core, and back down).
+// The flows from the hosts of the first edge switch to other pods must
+// spread evenly over its live up ports and the cores behind them.  With
+// failUp that switch has its first up port down.  Only the switch sees
+// it, so flows still come down that link, but none may go up it: those
+// for the aggregation switch and cores it leads to straight are dropped
+// at the switch, all others must take another port.
+class ModFatTreeTestCase : public TestCase
+{
+public:
+  ModFatTreeTestCase (uint32_t k, bool failUp);
+
+private:
+  static const uint32_t FLOWS = 16;
+  static const uint32_t MAX_HOPS = 6;
+
+  virtual void DoRun (void);
+  void CheckSpread (const std::map<Ipv4Address, uint32_t> &count, uint32_t expected, const char *stage);
+
+  uint32_t m_k;
+  bool m_failUp;
+};
+
+const uint32_t ModFatTreeTestCase::FLOWS;
+const uint32_t ModFatTreeTestCase::MAX_HOPS;
+
+ModFatTreeTestCase::ModFatTreeTestCase (uint32_t k, bool failUp)
+  : TestCase (std::string (k == 4 ? "Fat-tree k=4" : "Fat-tree k=6") + " routes" + (failUp ? ", failed up-link" : "")),
+    m_k (k),
+    m_failUp (failUp)
+{
+}
+
+void
+ModFatTreeTestCase::DoRun (void)
+{
+  ModFatTreeHelper fatTree (m_k);
+  fatTree.Install ();
+  uint32_t half = m_k / 2;
+  NodeContainer nodes;
+  nodes.Add (fatTree.GetHosts ());
+  nodes.Add (fatTree.GetEdges ());
+  nodes.Add (fatTree.GetAggregations ());
+  nodes.Add (fatTree.GetCores ());
+  std::vector<Ptr<ModFatTreeRouting> > agents;
+  std::vector<Ipv4Address> addrs;
+  std::map<Ipv4Address, uint32_t> index;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      agents.push_back (nodes.Get (i)->GetObject<ModFatTreeRouting> ());
+      addrs.push_back (nodes.Get (i)->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal ());
+      index[addrs.back ()] = i;
+    }
+  // the hosts come first, the edge switches after them
+  uint32_t failed = fatTree.GetHosts ().GetN ();
+  std::set<Ipv4Address> cut;
+  if (m_failUp)
+    {
+      nodes.Get (failed)->GetObject<Ipv4> ()->SetDown (half + 1);
+      cut.insert (ModFatTreeRouting::GetAggregationAddress (m_k, 0, 0));
+      for (uint32_t c = 0; c < half; c++)
+        {
+          cut.insert (ModFatTreeRouting::GetCoreAddress (m_k, 0, c));
+        }
+    }
+
+  std::map<Ipv4Address, uint32_t> viaAggregation, viaCore;
+  for (uint32_t s = 0; s < addrs.size (); s++)
+    {
+      for (uint32_t d = 0; d < addrs.size (); d++)
+        {
+          for (uint32_t flow = 0; flow < FLOWS && d != s; flow++)
+            {
+              std::vector<uint32_t> path (1, s);
+              for (uint32_t k = s; k != d; k = path.back ())
+                {
+                  NS_TEST_ASSERT_MSG_LT (path.size (), MAX_HOPS + 1,
+                                         addrs[s] << " -> " << addrs[d] << " takes more than " << MAX_HOPS << " hops");
+                  int32_t port = agents[k]->GetPort (addrs[d], FlowHash (flow, addrs[s], addrs[d], addrs[k]));
+                  if (k == failed && cut.count (addrs[d]) > 0)
+                    {
+                      NS_TEST_ASSERT_MSG_EQ (port, -1, addrs[s] << " -> " << addrs[d] << " takes the failed up-link");
+                      path.clear ();
+                      break;
+                    }
+                  NS_TEST_ASSERT_MSG_NE (port, -1, addrs[s] << " -> " << addrs[d] << " stops at " << addrs[k]);
+                  NS_TEST_ASSERT_MSG_EQ ((m_failUp && k == failed && port == (int32_t) half), false,
+                                         addrs[s] << " -> " << addrs[d] << " takes the failed up-link");
+                  std::map<Ipv4Address, uint32_t>::const_iterator next = index.find (agents[k]->GetNeighbor (port));
+                  NS_TEST_ASSERT_MSG_EQ ((next != index.end ()), true,
+                                         addrs[k] << " port " << port << " leads out of the tree");
+                  path.push_back (next->second);
+                }
+              // hosts of the first edge switch to hosts of other pods
+              if (!path.empty () && s < half && d >= half * half && d < failed)
+                {
+                  NS_TEST_ASSERT_MSG_EQ (path.size (), MAX_HOPS + 1, addrs[s] << " -> " << addrs[d] << " skips a stage");
+                  viaAggregation[addrs[path[2]]]++;
+                  viaCore[addrs[path[3]]]++;
+                }
+            }
+        }
+    }
+  uint32_t live = m_failUp ? half - 1 : half;
+  CheckSpread (viaAggregation, live, "aggregation");
+  CheckSpread (viaCore, live * half, "core");
+  Simulator::Destroy ();
+}
+
+// flows split over the expected number of switches, none carrying more
+// than half again as many flows as another
+void
+ModFatTreeTestCase::CheckSpread (const std::map<Ipv4Address, uint32_t> &count, uint32_t expected, const char *stage)
+{
+  NS_TEST_ASSERT_MSG_EQ (count.size (), expected, "flows use " << count.size () << " " << stage << " switches");
+  uint32_t least = ~0u, most = 0;
+  for (std::map<Ipv4Address, uint32_t>::const_iterator it = count.begin (); it != count.end (); ++it)
+    {
+      least = std::min (least, it->second);
+      most = std::max (most, it->second);
+    }
+  NS_TEST_ASSERT_MSG_LT (2 * most, 3 * least, stage << " switches carry from " << least << " to " << most << " flows");
+}
+
+class ModRoutingTestSuite : public TestSuite
+{
+public:
+  ModRoutingTestSuite ();
+};
+
+ModRoutingTestSuite::ModRoutingTestSuite ()
+  : TestSuite ("mod-routing", UNIT)
+{
+  static const ModRoutingTable::Mode modes[] = {
+    ModRoutingTable::EAGER, ModRoutingTable::LAZY_SOURCE, ModRoutingTable::LAZY_DESTINATION,
+    ModRoutingTable::HIERARCHICAL, ModRoutingTable::GEOGRAPHIC, ModRoutingTable::ON_DEMAND,
+    ModRoutingTable::CONTRACTION, ModRoutingTable::AGGREGATED
+  };
+  for (uint32_t m = 0; m < sizeof (modes) / sizeof (modes[0]); m++)
+    {
+      AddTestCase (new ModRoutesTestCase (modes[m], ModRoutingTable::HOP_COUNT, false), TestCase::QUICK);
+      AddTestCase (new ModRoutesTestCase (modes[m], ModRoutingTable::EUCLIDEAN, false), TestCase::QUICK);
+      // wired tables have no positions to route on
+      if (modes[m] != ModRoutingTable::GEOGRAPHIC)
+        {
+          AddTestCase (new ModRoutesTestCase (modes[m], ModRoutingTable::HOP_COUNT, true), TestCase::QUICK);
+        }
+    }
+  AddTestCase (new ModBudgetTestCase, TestCase::QUICK);
+  for (uint32_t k = 4; k <= 6; k += 2)
+    {
+      AddTestCase (new ModFatTreeTestCase (k, false), TestCase::QUICK);
+      AddTestCase (new ModFatTreeTestCase (k, true), TestCase::QUICK);
+    }
+}
+
+static ModRoutingTestSuite g_modRoutingTestSuite;